@@ -0,0 +1,93 @@
+//Nanoseconds per transform of RealFft against a naive DFT for every supported size.
+//Build and run with `make fft-benchmark`
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <vector>
+
+#include "../includes/fft.h"
+
+//O(N^2) reference, the first N/2+1 bins of the DFT of real input
+static void naive_dft(const float* input, int n, float* re, float* im) {
+    for (int k = 0; k <= n / 2; k++) {
+        double sumRe = 0.0, sumIm = 0.0;
+        for (int t = 0; t < n; t++) {
+            double angle = -2.0 * M_PI * k * t / n;
+            sumRe += input[t] * cos(angle);
+            sumIm += input[t] * sin(angle);
+        }
+        re[k] = static_cast<float>(sumRe);
+        im[k] = static_cast<float>(sumIm);
+    }
+}
+
+//Run `transform` until at least `minimum` seconds have passed, returns ns per call
+template <typename F>
+static double time_per_call(F transform, double minimum) {
+    using clock = std::chrono::steady_clock;
+    long calls = 0;
+    auto start = clock::now();
+    double elapsed = 0.0;
+
+    do {
+        transform();
+        calls++;
+        elapsed = std::chrono::duration<double>(clock::now() - start).count();
+    } while (elapsed < minimum);
+
+    return elapsed * 1e9 / calls;
+}
+
+template <int N>
+static bool run() {
+    std::vector<float> input(N);
+    for (float& sample : input)
+        sample = static_cast<float>(rand()) / RAND_MAX * 2.0f - 1.0f;
+
+    std::vector<float> fastRe(N / 2 + 1), fastIm(N / 2 + 1);
+    std::vector<float> naiveRe(N / 2 + 1), naiveIm(N / 2 + 1);
+
+    RealFft<N>* fft = new RealFft<N>();
+    fft->forward(input.data(), fastRe.data(), fastIm.data());
+    naive_dft(input.data(), N, naiveRe.data(), naiveIm.data());
+
+    //Largest error relative to the largest bin
+    double error = 0.0, peak = 0.0;
+    for (int k = 0; k <= N / 2; k++) {
+        error = std::max(error, static_cast<double>(std::hypot(fastRe[k] - naiveRe[k], fastIm[k] - naiveIm[k])));
+        peak = std::max(peak, static_cast<double>(std::hypot(naiveRe[k], naiveIm[k])));
+    }
+
+    volatile float sink = 0.0f;
+    double fast = time_per_call([&]() { fft->forward(input.data(), fastRe.data(), fastIm.data()); sink = fastRe[1]; }, 0.2);
+    double naive = time_per_call([&]() { naive_dft(input.data(), N, naiveRe.data(), naiveIm.data()); sink = naiveRe[1]; }, 0.2);
+    delete fft;
+
+    bool accurate = error / peak < 1e-4;
+    std::cout << std::setw(6) << N
+              << std::setw(14) << std::fixed << std::setprecision(1) << fast
+              << std::setw(16) << naive
+              << std::setw(10) << std::setprecision(0) << naive / fast << "x"
+              << std::setw(14) << std::scientific << std::setprecision(2) << error / peak
+              << (accurate ? "" : "  MISMATCH") << std::endl;
+    return accurate;
+}
+
+int main() {
+#if defined(__AVX__)
+    const char* kernel = "AVX";
+#elif defined(__SSE2__)
+    const char* kernel = "SSE2";
+#elif defined(__ARM_NEON)
+    const char* kernel = "NEON";
+#else
+    const char* kernel = "scalar";
+#endif
+    std::cout << "RealFft kernel: " << kernel << "\n"
+              << "     N  RealFft ns/op    naive DFT ns/op   speedup   rel. error" << std::endl;
+
+    bool accurate = run<256>() & run<512>() & run<1024>() & run<2048>() & run<4096>();
+    return accurate ? 0 : 1;
+}
@@ -0,0 +1,76 @@
+#include "accumulate.h"
+
+#include <iostream>
+
+static bool allocate_target(Accumulator& acc, int width, int height) {
+    if (!acc.texture) {
+        glGenTextures(1, &acc.texture);
+        glGenFramebuffers(1, &acc.framebuffer);
+    }
+
+    glBindTexture(GL_TEXTURE_2D, acc.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, acc.framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, acc.texture, 0);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    acc.width = width;
+    acc.height = height;
+    acc.samples = 0;
+    return complete;
+}
+
+int init_accumulator(Accumulator& acc, int width, int height) {
+    if (!allocate_target(acc, width, height)) {
+        std::cerr << "Accumulation framebuffer is not complete" << std::endl;
+        destroy_accumulator(acc);
+        return -1;
+    }
+    return 0;
+}
+
+void begin_accumulation(Accumulator& acc, const FrameState& state) {
+    int width = static_cast<int>(state.width);
+    int height = static_cast<int>(state.height);
+
+    if (width != acc.width || height != acc.height)
+        allocate_target(acc, width, height);
+
+    if (state.mouseX != acc.mouseX || state.mouseY != acc.mouseY) {
+        acc.mouseX = state.mouseX;
+        acc.mouseY = state.mouseY;
+        acc.samples = 0;
+    }
+
+    acc.samples++;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, acc.framebuffer);
+    glViewport(0, 0, acc.width, acc.height);
+
+    //mean_n = sample / n + mean_(n-1) * (1 - 1/n), the first sample simply replaces the old contents
+    glEnable(GL_BLEND);
+    glBlendColor(0.0f, 0.0f, 0.0f, 1.0f / acc.samples);
+    glBlendFunc(GL_CONSTANT_ALPHA, GL_ONE_MINUS_CONSTANT_ALPHA);
+}
+
+void end_accumulation(Accumulator& acc, GLuint framebuffer) {
+    glDisable(GL_BLEND);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, acc.framebuffer);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+    glBlitFramebuffer(0, 0, acc.width, acc.height, 0, 0, acc.width, acc.height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+}
+
+void destroy_accumulator(Accumulator& acc) {
+    if (acc.framebuffer)
+        glDeleteFramebuffers(1, &acc.framebuffer);
+    if (acc.texture)
+        glDeleteTextures(1, &acc.texture);
+
+    acc = Accumulator();
+}
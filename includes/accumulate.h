@@ -0,0 +1,30 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "uniforms.h"
+
+//Progressive accumulation for path-traced shaders. Every frame is one more sample blended
+//into a float32 running mean (constant blend factor 1/n), so a shader can trace 1 sample
+//per pixel per frame and converge over time. Restarts when the resolution or iMouse changes
+struct Accumulator {
+    GLuint framebuffer = 0;
+    GLuint texture = 0;
+    int width = 0;
+    int height = 0;
+
+    unsigned long samples = 0;
+    float mouseX = 0.0f;
+    float mouseY = 0.0f;
+};
+
+int init_accumulator(Accumulator& acc, int width, int height);
+
+//Restart if the view changed, then bind the accumulation target and blending for the next sample.
+//Leaves the viewport at the accumulator size
+void begin_accumulation(Accumulator& acc, const FrameState& state);
+
+//Stop blending and copy the running mean into `framebuffer`
+void end_accumulation(Accumulator& acc, GLuint framebuffer);
+
+void destroy_accumulator(Accumulator& acc);
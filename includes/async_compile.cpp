@@ -0,0 +1,129 @@
+#include "async_compile.h"
+#include "shader.h"
+
+#include <cstring>
+
+//From GL_KHR_parallel_shader_compile, not part of the generated glad headers
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+bool has_parallel_shader_compile() {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+
+    for (GLint i = 0; i < count; i++) {
+        const char* extension = reinterpret_cast<const char*>(glGetStringi(GL_EXTENSIONS, i));
+        if (!strcmp(extension, "GL_KHR_parallel_shader_compile") || !strcmp(extension, "GL_ARB_parallel_shader_compile"))
+            return true;
+    }
+    return false;
+}
+
+void init_async_compiler(AsyncCompiler& compiler, WorkerContextFn workerContext, void* userData) {
+    compiler.parallelCompile = has_parallel_shader_compile();
+    compiler.workerContext = workerContext;
+    compiler.workerData = userData;
+}
+
+void start_async_compile(AsyncCompiler& compiler, AsyncProgram& compile, const std::string& source) {
+    if (compiler.parallelCompile) {
+        //Every call returns straight away, the driver compiles and links on its own threads
+        const char* fragmentSource = source.c_str();
+
+        compile.vertexShader = glCreateShader(GL_VERTEX_SHADER);
+        glShaderSource(compile.vertexShader, 1, &vertexShaderSource, NULL);
+        glCompileShader(compile.vertexShader);
+
+        compile.fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+        glShaderSource(compile.fragmentShader, 1, &fragmentSource, NULL);
+        glCompileShader(compile.fragmentShader);
+
+        compile.program = glCreateProgram();
+        glAttachShader(compile.program, compile.vertexShader);
+        glAttachShader(compile.program, compile.fragmentShader);
+        glLinkProgram(compile.program);
+    }
+    else if (compiler.workerContext) {
+        AsyncProgram* target = &compile;
+        compile.worker = std::thread([&compiler, target, source]() {
+            std::lock_guard<std::mutex> lock(compiler.workerMutex);
+
+            GLuint program = 0;
+            if (compiler.workerContext(true, compiler.workerData)) {
+                program = create_program(source.c_str());
+                //The program has to be complete before another context may use it
+                glFinish();
+                compiler.workerContext(false, compiler.workerData);
+            }
+
+            target->workerProgram = program;
+            target->workerDone = true;
+        });
+    }
+    else {
+        //No way to compile off the render thread, this will hitch
+        compile.workerProgram = create_program(source.c_str());
+        compile.workerDone = true;
+    }
+}
+
+bool async_compile_pending(const AsyncProgram& compile) {
+    return compile.program || compile.worker.joinable() || compile.workerDone;
+}
+
+GLuint finish_async_compile(AsyncProgram& compile, bool& done) {
+    done = false;
+
+    if (compile.program) {
+        GLint complete = GL_FALSE;
+        glGetProgramiv(compile.program, GL_COMPLETION_STATUS_KHR, &complete);
+        if (!complete)
+            return 0;
+
+        done = true;
+        bool linked = checkCompileErrors(compile.fragmentShader, "FRAGMENT")
+                      && checkCompileErrors(compile.program, "PROGRAM");
+
+        glDeleteShader(compile.vertexShader);
+        glDeleteShader(compile.fragmentShader);
+
+        GLuint program = compile.program;
+        compile.program = compile.vertexShader = compile.fragmentShader = 0;
+
+        if (!linked) {
+            glDeleteProgram(program);
+            return 0;
+        }
+        return program;
+    }
+
+    if (compile.workerDone) {
+        if (compile.worker.joinable())
+            compile.worker.join();
+        compile.workerDone = false;
+        done = true;
+
+        GLuint program = compile.workerProgram;
+        compile.workerProgram = 0;
+        return program;
+    }
+
+    return 0;
+}
+
+void cancel_async_compile(AsyncProgram& compile) {
+    if (compile.worker.joinable())
+        compile.worker.join();
+    if (compile.workerProgram)
+        glDeleteProgram(compile.workerProgram);
+    compile.workerProgram = 0;
+    compile.workerDone = false;
+
+    if (compile.program) {
+        glDeleteShader(compile.vertexShader);
+        glDeleteShader(compile.fragmentShader);
+        glDeleteProgram(compile.program);
+        compile.program = compile.vertexShader = compile.fragmentShader = 0;
+    }
+}
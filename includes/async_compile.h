@@ -0,0 +1,54 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <thread>
+
+//Makes a context sharing objects with the render context current on the calling thread,
+//or releases it again when `current` is false
+typedef bool (*WorkerContextFn)(bool current, void* userData);
+
+//Compiles programs off the render path. With GL_KHR_parallel_shader_compile the driver compiles
+//on its own threads and completion is polled, otherwise a thread compiles on a worker context
+//sharing objects with the render context. Without either, compiles block the caller
+struct AsyncCompiler {
+    bool parallelCompile = false;
+
+    WorkerContextFn workerContext = nullptr;
+    void* workerData = nullptr;
+    std::mutex workerMutex; //One worker context, so one compile thread at a time
+};
+
+//One program being compiled
+struct AsyncProgram {
+    //Parallel shader compile: objects compiling on the driver's own threads
+    GLuint program = 0;
+    GLuint vertexShader = 0;
+    GLuint fragmentShader = 0;
+
+    //Fallback: a thread compiling on the shared worker context
+    std::thread worker;
+    std::atomic<bool> workerDone{false};
+    GLuint workerProgram = 0;
+};
+
+//Whether the driver can compile and link without blocking the calling thread
+bool has_parallel_shader_compile();
+
+//`workerContext` is only used when the driver has no parallel shader compile and may be null then
+void init_async_compiler(AsyncCompiler& compiler, WorkerContextFn workerContext, void* userData);
+
+//Start compiling `source` against the quad vertex shader
+void start_async_compile(AsyncCompiler& compiler, AsyncProgram& compile, const std::string& source);
+
+//Whether a compile was started and hasn't been collected yet
+bool async_compile_pending(const AsyncProgram& compile);
+
+//Collect a finished compile without blocking. `done` tells whether it finished, the result is
+//the linked program or 0 if compiling or linking failed (the log has been printed)
+GLuint finish_async_compile(AsyncProgram& compile, bool& done);
+
+//Wait for a compile in flight and throw its result away
+void cancel_async_compile(AsyncProgram& compile);
@@ -0,0 +1,99 @@
+#include "audio_analysis.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+
+//Web Audio AnalyserNode defaults, which is what Shadertoy's audio texture is made with
+static const float SMOOTHING = 0.8f;
+static const float MIN_DECIBELS = -100.0f;
+static const float MAX_DECIBELS = -30.0f;
+
+//Fill the back block with the spectrum and waveform of the current history and publish it
+static void analyse(AudioAnalysis& analysis) {
+    for (int i = 0; i < AUDIO_FFT_SIZE; i++)
+        analysis.windowed[i] = analysis.history[i] * analysis.window[i];
+    analysis.fft.forward(analysis.windowed.data(), analysis.binsRe.data(), analysis.binsIm.data());
+
+    float* texels = latest_back_block(analysis.latest);
+
+    //Row 0: smoothed magnitude in dB, MIN_DECIBELS..MAX_DECIBELS mapped to 0..1
+    for (int bin = 0; bin < AUDIO_BLOCK_SIZE; bin++) {
+        float magnitude = std::hypot(analysis.binsRe[bin], analysis.binsIm[bin]) / AUDIO_FFT_SIZE;
+        float& smoothed = analysis.smoothed[bin];
+        smoothed = SMOOTHING * smoothed + (1.0f - SMOOTHING) * magnitude;
+
+        float decibels = 20.0f * std::log10(std::max(smoothed, 1e-12f));
+        texels[bin] = std::min(std::max((decibels - MIN_DECIBELS) / (MAX_DECIBELS - MIN_DECIBELS), 0.0f), 1.0f);
+    }
+
+    //Row 1: the newest samples, -1..1 mapped to 0..1
+    const float* newest = analysis.history.data() + AUDIO_FFT_SIZE - AUDIO_BLOCK_SIZE;
+    for (int i = 0; i < AUDIO_BLOCK_SIZE; i++)
+        texels[AUDIO_BLOCK_SIZE + i] = std::min(std::max(0.5f + 0.5f * newest[i], 0.0f), 1.0f);
+
+    publish_latest_block(analysis.latest);
+}
+
+//Gather everything the callback produced so far, analysing once per AUDIO_BLOCK_SIZE new samples
+static void drain_input(AudioAnalysis& analysis) {
+    float* end = analysis.history.data() + AUDIO_FFT_SIZE;
+
+    for (;;) {
+        size_t read = read_audio_ring(analysis.input, end - AUDIO_BLOCK_SIZE + analysis.filled,
+                                      AUDIO_BLOCK_SIZE - analysis.filled);
+        if (!read)
+            break;
+
+        analysis.filled += read;
+        if (analysis.filled == AUDIO_BLOCK_SIZE) {
+            analyse(analysis);
+
+            //Slide the history, the next block is read in at the end
+            std::copy(analysis.history.begin() + AUDIO_BLOCK_SIZE, analysis.history.end(), analysis.history.begin());
+            analysis.filled = 0;
+        }
+    }
+}
+
+static void analysis_thread(AudioAnalysis* analysis) {
+    while (analysis->running.load(std::memory_order_relaxed)) {
+        drain_input(*analysis);
+
+        //A block takes ~11ms to arrive at 44.1kHz, polling a few times per block is plenty
+        //and keeps the callback free of any wake-up call
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+    }
+}
+
+void start_audio_analysis(AudioAnalysis& analysis) {
+    init_audio_ring(analysis.input, AUDIO_RING_SIZE);
+    analysis.history.assign(AUDIO_FFT_SIZE, 0.0f);
+    analysis.smoothed.assign(AUDIO_BLOCK_SIZE, 0.0f);
+    analysis.windowed.resize(AUDIO_FFT_SIZE);
+    analysis.binsRe.resize(RealFft<AUDIO_FFT_SIZE>::BINS);
+    analysis.binsIm.resize(RealFft<AUDIO_FFT_SIZE>::BINS);
+
+    analysis.window.resize(AUDIO_FFT_SIZE);
+    for (int i = 0; i < AUDIO_FFT_SIZE; i++) {
+        double x = 2.0 * M_PI * i / AUDIO_FFT_SIZE;
+        analysis.window[i] = static_cast<float>(0.42 - 0.5 * cos(x) + 0.08 * cos(2.0 * x));
+    }
+
+    analysis.running = true;
+    analysis.thread = std::thread(analysis_thread, &analysis);
+}
+
+void push_audio_samples(AudioAnalysis& analysis, const float* samples, unsigned long count) {
+    write_audio_ring(analysis.input, samples, count);
+}
+
+bool latest_audio_block(AudioAnalysis& analysis, const float*& block) {
+    return acquire_latest_block(analysis.latest, block);
+}
+
+void stop_audio_analysis(AudioAnalysis& analysis) {
+    analysis.running = false;
+    if (analysis.thread.joinable())
+        analysis.thread.join();
+}
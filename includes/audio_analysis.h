@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "audio_ring.h"
+#include "fft.h"
+
+//Points of the spectrum transform. Like Shadertoy's 2048 point analyser only the lowest
+//AUDIO_BLOCK_SIZE bins (0-11kHz at 44.1kHz) make it into the texture
+const int AUDIO_FFT_SIZE = 2048;
+
+//Audio handed from the real-time callback to the render thread. The callback pushes samples
+//into `input`, a normal priority thread turns every AUDIO_BLOCK_SIZE of them into a
+//Shadertoy audio texture and publishes it to `latest`, where the render thread picks it up.
+//Nothing on the way locks
+struct AudioAnalysis {
+    AudioRing input;
+    LatestBlock latest;
+
+    std::thread thread;
+    std::atomic<bool> running{false};
+
+    //Analysis thread only
+    std::vector<float> history;  //Last AUDIO_FFT_SIZE samples, oldest first
+    int filled = 0;              //New samples at the end of history since the last analysis
+    std::vector<float> window;   //Blackman window
+    std::vector<float> smoothed; //Magnitude per bin, averaged over time
+    std::vector<float> windowed;
+    std::vector<float> binsRe, binsIm;
+    RealFft<AUDIO_FFT_SIZE> fft;
+};
+
+//Start the analysis thread
+void start_audio_analysis(AudioAnalysis& analysis);
+
+//Called from the audio callback, never blocks
+void push_audio_samples(AudioAnalysis& analysis, const float* samples, unsigned long count);
+
+//Newest audio texture for the render thread (AUDIO_TEXTURE_SIZE texels, spectrum row first),
+//valid until the next call. Returns true when it is newer than the one returned last time
+bool latest_audio_block(AudioAnalysis& analysis, const float*& block);
+
+//Stop and join the analysis thread, call once the stream is stopped
+void stop_audio_analysis(AudioAnalysis& analysis);
@@ -0,0 +1,176 @@
+#include "audio_backend.h"
+
+#include <iostream>
+#include <cstring>
+#include <vector>
+#include <portaudio.h>
+
+//Frames per callback, for PortAudio and the timer clocked backends alike
+static const unsigned long BLOCK_FRAMES = 512;
+
+int parse_audio_backend(const char* str, AudioBackendType& type, std::string& wavPath) {
+    if (!strcmp(str, "portaudio"))
+        type = AUDIO_PORTAUDIO;
+    else if (!strcmp(str, "null"))
+        type = AUDIO_NULL;
+    else if (!strncmp(str, "wav:", 4) && str[4]) {
+        type = AUDIO_WAV;
+        wavPath = str + 4;
+    }
+    else
+        return -1;
+    return 0;
+}
+
+void prepare_audio_backend(AudioBackend& backend, AudioBackendType type, const std::string& wavPath) {
+    backend.type = type;
+    backend.wavPath = wavPath;
+
+    //Device enumeration runs while the caller creates its GL context
+    if (type == AUDIO_PORTAUDIO) {
+        backend.initThread = std::thread([&backend]() {
+            backend.initError = Pa_Initialize();
+        });
+    }
+}
+
+//Wait for Pa_Initialize, returns its error
+static int finish_init(AudioBackend& backend) {
+    if (backend.initThread.joinable()) {
+        backend.initThread.join();
+        backend.initialized = backend.initError == paNoError;
+    }
+    return backend.initError;
+}
+
+static int portaudio_callback(const void* input, void* output, unsigned long frames,
+                              const PaStreamCallbackTimeInfo* timeInfo, PaStreamCallbackFlags statusFlags,
+                              void* userData) {
+    (void)input;
+    (void)statusFlags;
+
+    AudioBackend* backend = static_cast<AudioBackend*>(userData);
+    backend->callback(static_cast<float*>(output), frames, timeInfo->outputBufferDacTime, backend->userData);
+    return paContinue;
+}
+
+static int start_portaudio(AudioBackend& backend) {
+    PaError err = finish_init(backend);
+    if (err != paNoError) {
+        std::cerr << "PortAudio error: " << Pa_GetErrorText(err) << std::endl;
+        return -1;
+    }
+
+    PaStream* stream = nullptr;
+    err = Pa_OpenDefaultStream(
+        &stream,
+        0,                  //No input
+        2,                  //Stereo output
+        paFloat32,          //32-bit float
+        backend.sampleRate,
+        BLOCK_FRAMES,       //Larger buffer to reduce glitches
+        portaudio_callback,
+        &backend
+    );
+    if (err == paNoError) {
+        backend.stream = stream;
+        err = Pa_StartStream(stream);
+    }
+
+    if (err != paNoError) {
+        std::cerr << "PortAudio error: " << Pa_GetErrorText(err) << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+//Canonical 44 byte header of a stereo 32-bit float WAV, sizes patched in when the file is closed
+static void write_wav_header(FILE* file, int sampleRate, uint64_t frames) {
+    const uint32_t dataBytes = static_cast<uint32_t>(frames * 2 * sizeof(float));
+    const uint32_t header[] = {
+        0x46464952, 36 + dataBytes,                  //"RIFF", size of the rest
+        0x45564157, 0x20746d66, 16,                  //"WAVE", "fmt ", format chunk size
+        3 | (2 << 16),                               //WAVE_FORMAT_IEEE_FLOAT, 2 channels
+        static_cast<uint32_t>(sampleRate),
+        static_cast<uint32_t>(sampleRate) * 8,       //Bytes per second
+        8 | (32 << 16),                              //Bytes per frame, bits per sample
+        0x61746164, dataBytes                        //"data", size
+    };
+    fwrite(header, sizeof(header), 1, file);
+}
+
+//Call the callback every BLOCK_FRAMES worth of wall time, writing the output to the WAV file if there is one
+static void clock_thread(AudioBackend* backend) {
+    std::vector<float> buffer(BLOCK_FRAMES * 2);
+    uint64_t frames = 0;
+
+    while (backend->running.load(std::memory_order_relaxed)) {
+        backend->callback(buffer.data(), BLOCK_FRAMES, static_cast<double>(frames) / backend->sampleRate, backend->userData);
+
+        if (backend->wavFile)
+            fwrite(buffer.data(), sizeof(float) * 2, BLOCK_FRAMES, backend->wavFile);
+        frames += BLOCK_FRAMES;
+
+        //Deadlines come from the frame count, so sleeping late never accumulates into drift
+        std::this_thread::sleep_until(backend->clockStart + std::chrono::duration<double>(
+                                          static_cast<double>(frames) / backend->sampleRate));
+    }
+    backend->wavFrames = frames;
+}
+
+int start_audio_backend(AudioBackend& backend, int sampleRate, AudioCallback callback, void* userData) {
+    backend.sampleRate = sampleRate;
+    backend.callback = callback;
+    backend.userData = userData;
+
+    if (backend.type == AUDIO_PORTAUDIO)
+        return start_portaudio(backend);
+
+    if (backend.type == AUDIO_WAV) {
+        backend.wavFile = fopen(backend.wavPath.c_str(), "wb");
+        if (!backend.wavFile) {
+            std::cerr << "Failed to open " << backend.wavPath << " for writing" << std::endl;
+            return -1;
+        }
+        write_wav_header(backend.wavFile, sampleRate, 0);
+    }
+
+    backend.clockStart = std::chrono::steady_clock::now();
+    backend.running = true;
+    backend.clockThread = std::thread(clock_thread, &backend);
+    return 0;
+}
+
+double audio_backend_time(const AudioBackend& backend) {
+    if (backend.type == AUDIO_PORTAUDIO)
+        return backend.stream ? Pa_GetStreamTime(static_cast<PaStream*>(backend.stream)) : 0.0;
+
+    if (!backend.running)
+        return 0.0;
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - backend.clockStart).count();
+}
+
+void stop_audio_backend(AudioBackend& backend) {
+    finish_init(backend);
+
+    if (backend.stream) {
+        Pa_StopStream(static_cast<PaStream*>(backend.stream));
+        Pa_CloseStream(static_cast<PaStream*>(backend.stream));
+        backend.stream = nullptr;
+    }
+    if (backend.initialized) {
+        Pa_Terminate();
+        backend.initialized = false;
+    }
+
+    backend.running = false;
+    if (backend.clockThread.joinable())
+        backend.clockThread.join();
+
+    if (backend.wavFile) {
+        rewind(backend.wavFile);
+        write_wav_header(backend.wavFile, backend.sampleRate, backend.wavFrames);
+        fclose(backend.wavFile);
+        backend.wavFile = nullptr;
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+
+//Fill `frames` interleaved stereo float frames. Runs on the backend's audio thread, `dacTime`
+//is the backend time (see audio_backend_time) at which the first frame is heard
+typedef void (*AudioCallback)(float* output, unsigned long frames, double dacTime, void* userData);
+
+enum AudioBackendType {
+    AUDIO_PORTAUDIO, //Default output device
+    AUDIO_NULL,      //No device, the callback is clocked by a timer
+    AUDIO_WAV        //Like null, but what the callback produces is written to a WAV file
+};
+
+//Where the audio callback's output goes. PortAudio is only touched by the PortAudio backend,
+//and its initialisation (device enumeration can take hundreds of milliseconds) runs on a
+//background thread from prepare_audio_backend until start_audio_backend needs it
+struct AudioBackend {
+    AudioBackendType type = AUDIO_PORTAUDIO;
+    std::string wavPath;
+
+    int sampleRate = 0;
+    AudioCallback callback = nullptr;
+    void* userData = nullptr;
+
+    //PortAudio
+    std::thread initThread;
+    int initError = 0; //PaError of Pa_Initialize, read after joining initThread
+    bool initialized = false;
+    void* stream = nullptr;
+
+    //Null and WAV: a thread calling the callback every block
+    std::thread clockThread;
+    std::atomic<bool> running{false};
+    std::chrono::steady_clock::time_point clockStart;
+    FILE* wavFile = nullptr;
+    uint64_t wavFrames = 0;
+};
+
+//"portaudio", "null" or "wav:<path>"
+int parse_audio_backend(const char* str, AudioBackendType& type, std::string& wavPath);
+
+//Start whatever slow setup the backend needs in the background, call as early as possible
+void prepare_audio_backend(AudioBackend& backend, AudioBackendType type, const std::string& wavPath);
+
+//Open the output at `sampleRate` and start calling `callback`. Waits for prepare_audio_backend's setup
+int start_audio_backend(AudioBackend& backend, int sampleRate, AudioCallback callback, void* userData);
+
+//Seconds on the backend's clock, the time base of the callback's `dacTime`
+double audio_backend_time(const AudioBackend& backend);
+
+//Stop the callback, finish the WAV file and release the device
+void stop_audio_backend(AudioBackend& backend);
@@ -0,0 +1,164 @@
+#include "audio_file.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+//WAVE_FORMAT_* tags
+static const int WAV_PCM = 1;
+static const int WAV_FLOAT = 3;
+static const int WAV_EXTENSIBLE = 0xFFFE;
+
+static uint32_t le32(const unsigned char* p) {
+    return p[0] | (p[1] << 8) | (p[2] << 16) | (static_cast<uint32_t>(p[3]) << 24);
+}
+
+static uint16_t le16(const unsigned char* p) {
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+//Walk the RIFF chunks up to "data", leaving the file at the first sample
+static int open_wav(AudioFile& audio, const std::string& path) {
+    bool haveFormat = false;
+    int formatTag = 0;
+    int blockAlign = 0;
+
+    for (;;) {
+        unsigned char chunk[8];
+        if (fread(chunk, 1, 8, audio.file) != 8) {
+            std::cerr << path << " has no data chunk" << std::endl;
+            return -1;
+        }
+        uint32_t size = le32(chunk + 4);
+
+        if (!memcmp(chunk, "fmt ", 4)) {
+            unsigned char format[40] = {0};
+            size_t read = std::min<size_t>(size, sizeof(format));
+            if (size < 16 || fread(format, 1, read, audio.file) != read) {
+                std::cerr << path << " has a broken fmt chunk" << std::endl;
+                return -1;
+            }
+            fseek(audio.file, static_cast<long>(size - read + (size & 1)), SEEK_CUR);
+
+            formatTag = le16(format);
+            audio.channels = le16(format + 2);
+            audio.sampleRate = static_cast<int>(le32(format + 4));
+            blockAlign = le16(format + 12);
+            audio.bitsPerSample = le16(format + 14);
+
+            //The actual format is the first two bytes of the sub-format GUID
+            if (formatTag == WAV_EXTENSIBLE && size >= 26)
+                formatTag = le16(format + 24);
+            haveFormat = true;
+        }
+        else if (!memcmp(chunk, "data", 4)) {
+            //Streaming writers leave the size at its maximum, play until the file ends then
+            audio.dataRemaining = size;
+            break;
+        }
+        else {
+            fseek(audio.file, static_cast<long>(size + (size & 1)), SEEK_CUR);
+        }
+    }
+
+    audio.floatSamples = formatTag == WAV_FLOAT;
+    bool supported = haveFormat && audio.channels > 0 && audio.sampleRate > 0 && blockAlign > 0
+                     && ((formatTag == WAV_PCM && audio.bitsPerSample % 8 == 0 && audio.bitsPerSample >= 8
+                          && audio.bitsPerSample <= 32)
+                         || (formatTag == WAV_FLOAT && audio.bitsPerSample == 32));
+    if (!supported) {
+        std::cerr << path << ": only 8-32 bit PCM and 32 bit float WAV files are supported" << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+int open_audio_file(AudioFile& audio, const std::string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file) {
+        std::cerr << "Failed to open audio file: " << path << std::endl;
+        return -1;
+    }
+
+    unsigned char magic[12];
+    if (fread(magic, 1, sizeof(magic), file) != sizeof(magic)) {
+        std::cerr << path << " is too short to be an audio file" << std::endl;
+        fclose(file);
+        return -1;
+    }
+
+    if (!memcmp(magic, "fLaC", 4)) {
+        rewind(file);
+        audio.type = AUDIO_FILE_FLAC;
+        if (open_flac(audio.flac, file))
+            return -1;
+
+        audio.sampleRate = audio.flac.sampleRate;
+        audio.channels = audio.flac.channels;
+        audio.bitsPerSample = audio.flac.bitsPerSample;
+        return 0;
+    }
+
+    if (memcmp(magic, "RIFF", 4) || memcmp(magic + 8, "WAVE", 4)) {
+        std::cerr << path << " is neither a WAV nor a FLAC file" << std::endl;
+        fclose(file);
+        return -1;
+    }
+
+    audio.type = AUDIO_FILE_WAV;
+    audio.file = file;
+    if (open_wav(audio, path)) {
+        close_audio_file(audio);
+        return -1;
+    }
+    return 0;
+}
+
+//Convert one sample of the WAV's format to -1..1
+static float wav_sample(const AudioFile& audio, const unsigned char* p) {
+    switch (audio.bitsPerSample) {
+        case 8:  return (p[0] - 128) / 128.0f; //8 bit WAV is unsigned
+        case 16: return static_cast<int16_t>(le16(p)) / 32768.0f;
+        case 24: return static_cast<int32_t>((p[0] << 8) | (p[1] << 16) | (static_cast<uint32_t>(p[2]) << 24)) / 2147483648.0f;
+        default: break;
+    }
+
+    uint32_t bits = le32(p);
+    if (audio.floatSamples) {
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+    return static_cast<int32_t>(bits) / 2147483648.0f;
+}
+
+static size_t read_wav(AudioFile& audio, float* stereo, size_t frames) {
+    size_t sampleBytes = audio.bitsPerSample / 8;
+    size_t frameBytes = sampleBytes * audio.channels;
+
+    frames = std::min<uint64_t>(frames, audio.dataRemaining / frameBytes);
+    audio.raw.resize(frames * frameBytes);
+
+    size_t read = fread(audio.raw.data(), frameBytes, frames, audio.file);
+    audio.dataRemaining -= read * frameBytes;
+
+    const unsigned char* p = audio.raw.data();
+    for (size_t i = 0; i < read; i++, p += frameBytes) {
+        stereo[2 * i] = wav_sample(audio, p);
+        stereo[2 * i + 1] = audio.channels > 1 ? wav_sample(audio, p + sampleBytes) : stereo[2 * i];
+    }
+    return read;
+}
+
+size_t read_audio_file(AudioFile& audio, float* stereo, size_t frames) {
+    if (audio.type == AUDIO_FILE_FLAC)
+        return read_flac_frames(audio.flac, stereo, frames);
+    return read_wav(audio, stereo, frames);
+}
+
+void close_audio_file(AudioFile& audio) {
+    close_flac(audio.flac);
+    if (audio.file)
+        fclose(audio.file);
+    audio.file = nullptr;
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "flac.h"
+
+enum AudioFileType {
+    AUDIO_FILE_WAV,
+    AUDIO_FILE_FLAC
+};
+
+//A WAV or FLAC file decoded incrementally to interleaved stereo floats. Mono is duplicated
+//to both sides, channels past the second are dropped
+struct AudioFile {
+    AudioFileType type = AUDIO_FILE_WAV;
+    int sampleRate = 0;
+    int channels = 0;
+
+    //WAV: PCM (8-32 bit integer or 32 bit float) read straight from the data chunk
+    FILE* file = nullptr;
+    int bitsPerSample = 0;
+    bool floatSamples = false;
+    uint64_t dataRemaining = 0; //Bytes left in the data chunk
+    std::vector<unsigned char> raw;
+
+    FlacDecoder flac;
+};
+
+//Open a file and read its header, the type is detected from the contents
+int open_audio_file(AudioFile& audio, const std::string& path);
+
+//Decode up to `frames` stereo frames, returns how many were written (0 at the end of the file)
+size_t read_audio_file(AudioFile& audio, float* stereo, size_t frames);
+
+void close_audio_file(AudioFile& audio);
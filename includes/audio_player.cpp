@@ -0,0 +1,93 @@
+#include "audio_player.h"
+
+#include <chrono>
+#include <cstring>
+
+//Stereo frames decoded per step of the prefetch thread
+static const size_t PREFETCH_FRAMES = 4096;
+
+//Decode while the ring has room for a whole step. Returns false once the file is done
+static bool prefetch(AudioPlayer& player, float* scratch) {
+    while (audio_ring_space(player.ring) >= PREFETCH_FRAMES * 2) {
+        size_t frames = read_audio_file(player.file, scratch, PREFETCH_FRAMES);
+        if (!frames)
+            return false;
+        write_audio_ring(player.ring, scratch, frames * 2);
+    }
+    return true;
+}
+
+static void prefetch_thread(AudioPlayer* player) {
+    std::vector<float> scratch(PREFETCH_FRAMES * 2);
+
+    while (player->running.load(std::memory_order_relaxed)) {
+        if (!prefetch(*player, scratch.data())) {
+            player->decoded = true;
+            break;
+        }
+
+        //The ring holds seconds of audio, topping it up every few milliseconds is plenty
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+}
+
+int start_audio_player(AudioPlayer& player, const std::string& path) {
+    if (open_audio_file(player.file, path))
+        return -1;
+
+    init_audio_ring(player.ring, PLAYER_RING_SIZE);
+
+    //Fill the ring before playback starts so the first callbacks don't underrun
+    std::vector<float> scratch(PREFETCH_FRAMES * 2);
+    player.decoded = !prefetch(player, scratch.data());
+
+    player.running = true;
+    if (!player.decoded)
+        player.prefetch = std::thread(prefetch_thread, &player);
+    return 0;
+}
+
+void play_audio_frames(AudioPlayer& player, float* output, unsigned long frames, double dacTime) {
+    size_t read = read_audio_ring(player.ring, output, frames * 2);
+    memset(output + read, 0, (frames * 2 - read) * sizeof(float));
+
+    if (read < frames * 2 && !player.decoded.load(std::memory_order_relaxed))
+        player.underruns.fetch_add(1, std::memory_order_relaxed);
+
+    player.clockSequence.fetch_add(1, std::memory_order_acq_rel);
+    player.clockFrames.store(player.playedFrames, std::memory_order_relaxed);
+    player.clockDacTime.store(dacTime, std::memory_order_relaxed);
+    player.clockSequence.fetch_add(1, std::memory_order_release);
+
+    player.playedFrames += read / 2;
+}
+
+double audio_player_time(const AudioPlayer& player, double streamTime) {
+    uint64_t frames;
+    double dacTime;
+    unsigned sequence;
+
+    //Retry if the callback updated the clock while it was being read
+    do {
+        sequence = player.clockSequence.load(std::memory_order_acquire);
+        frames = player.clockFrames.load(std::memory_order_relaxed);
+        dacTime = player.clockDacTime.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+    } while ((sequence & 1) || sequence != player.clockSequence.load(std::memory_order_relaxed));
+
+    if (!sequence || !player.file.sampleRate)
+        return 0.0;
+
+    //Hosts that don't report DAC times get the time of the last buffer
+    double time = static_cast<double>(frames) / player.file.sampleRate;
+    if (dacTime > 0.0)
+        time += streamTime - dacTime;
+    return time > 0.0 ? time : 0.0;
+}
+
+void stop_audio_player(AudioPlayer& player) {
+    player.running = false;
+    if (player.prefetch.joinable())
+        player.prefetch.join();
+    close_audio_file(player.file);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <thread>
+
+#include "audio_file.h"
+#include "audio_ring.h"
+
+//Interleaved stereo samples decoded ahead of playback, ~3s at 44.1kHz
+const size_t PLAYER_RING_SIZE = 1 << 18;
+
+//Streams an audio file to the output. A prefetch thread decodes into a lock-free ring and
+//the audio callback only copies out of it, so decoding never runs on the real-time thread
+//and only PLAYER_RING_SIZE samples of the track are ever held in memory
+struct AudioPlayer {
+    AudioFile file;
+    AudioRing ring;
+
+    std::thread prefetch;
+    std::atomic<bool> running{false};
+    std::atomic<bool> decoded{false}; //The prefetch thread reached the end of the file
+
+    //Playback clock, written by the callback: frames played before the current buffer and the
+    //stream time its first sample reaches the DAC. `clockSequence` is odd while they change
+    std::atomic<unsigned> clockSequence{0};
+    std::atomic<uint64_t> clockFrames{0};
+    std::atomic<double> clockDacTime{0.0};
+
+    uint64_t playedFrames = 0; //Callback only
+    std::atomic<uint64_t> underruns{0};
+};
+
+//Open the file, decode the first few seconds and start the prefetch thread
+int start_audio_player(AudioPlayer& player, const std::string& path);
+
+//Callback side: copy `frames` stereo frames into `output`, silence past the end or on an
+//underrun. `dacTime` is when the first of them will be heard, in stream time
+void play_audio_frames(AudioPlayer& player, float* output, unsigned long frames, double dacTime);
+
+//Seconds of the track heard at `streamTime`, interpolated between callbacks so visuals
+//stay locked to the samples coming out of the speakers
+double audio_player_time(const AudioPlayer& player, double streamTime);
+
+void stop_audio_player(AudioPlayer& player);
@@ -0,0 +1,70 @@
+#include "audio_ring.h"
+
+#include <algorithm>
+#include <cstring>
+
+//Set on the middle index when the writer has published since the reader last looked
+static const int FRESH = 4;
+
+void init_audio_ring(AudioRing& ring, size_t capacity) {
+    ring.samples.assign(capacity, 0.0f);
+    ring.mask = capacity - 1;
+    ring.head = 0;
+    ring.tail = 0;
+    ring.dropped = 0;
+}
+
+size_t audio_ring_space(const AudioRing& ring) {
+    return ring.samples.size() - (ring.head.load(std::memory_order_relaxed) - ring.tail.load(std::memory_order_acquire));
+}
+
+size_t write_audio_ring(AudioRing& ring, const float* samples, size_t count) {
+    size_t head = ring.head.load(std::memory_order_relaxed);
+    size_t tail = ring.tail.load(std::memory_order_acquire);
+
+    size_t written = std::min(count, ring.samples.size() - (head - tail));
+    if (written < count)
+        ring.dropped.fetch_add(count - written, std::memory_order_relaxed);
+
+    //The free space may wrap around the end of the array
+    size_t start = head & ring.mask;
+    size_t first = std::min(written, ring.samples.size() - start);
+    memcpy(ring.samples.data() + start, samples, first * sizeof(float));
+    memcpy(ring.samples.data(), samples + first, (written - first) * sizeof(float));
+
+    ring.head.store(head + written, std::memory_order_release);
+    return written;
+}
+
+size_t read_audio_ring(AudioRing& ring, float* samples, size_t count) {
+    size_t tail = ring.tail.load(std::memory_order_relaxed);
+    size_t head = ring.head.load(std::memory_order_acquire);
+
+    size_t read = std::min(count, head - tail);
+
+    size_t start = tail & ring.mask;
+    size_t first = std::min(read, ring.samples.size() - start);
+    memcpy(samples, ring.samples.data() + start, first * sizeof(float));
+    memcpy(samples + first, ring.samples.data(), (read - first) * sizeof(float));
+
+    ring.tail.store(tail + read, std::memory_order_release);
+    return read;
+}
+
+float* latest_back_block(LatestBlock& latest) {
+    return latest.blocks[latest.back];
+}
+
+void publish_latest_block(LatestBlock& latest) {
+    //Release the finished block, take whatever the reader isn't holding as the next back block
+    latest.back = latest.middle.exchange(latest.back | FRESH, std::memory_order_acq_rel) & ~FRESH;
+}
+
+bool acquire_latest_block(LatestBlock& latest, const float*& block) {
+    bool fresh = latest.middle.load(std::memory_order_relaxed) & FRESH;
+    if (fresh)
+        latest.front = latest.middle.exchange(latest.front, std::memory_order_acq_rel) & ~FRESH;
+
+    block = latest.blocks[latest.front];
+    return fresh;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <vector>
+
+//Samples the analysis ring holds, about 185ms at 44.1kHz
+const size_t AUDIO_RING_SIZE = 8192;
+
+//Samples per analysis step, also the width of the audio texture
+const int AUDIO_BLOCK_SIZE = 512;
+
+//Texels of the Shadertoy audio texture: a row of spectrum, then a row of waveform
+const int AUDIO_TEXTURE_SIZE = AUDIO_BLOCK_SIZE * 2;
+
+//Wait-free single producer / single consumer ring of samples. Neither side ever locks or
+//allocates, a producer drops what doesn't fit instead of waiting. Head and tail live on
+//separate cache lines so the two threads don't keep stealing the line from each other
+struct AudioRing {
+    std::vector<float> samples;
+    size_t mask = 0; //Capacity - 1
+
+    alignas(64) std::atomic<size_t> head{0};    //Written by the producer only
+    alignas(64) std::atomic<size_t> tail{0};    //Written by the consumer only
+    alignas(64) std::atomic<size_t> dropped{0}; //Samples the producer had no room for
+};
+
+//Allocate room for `capacity` samples, a power of two. Call before either side starts
+void init_audio_ring(AudioRing& ring, size_t capacity);
+
+//Samples the producer could write right now
+size_t audio_ring_space(const AudioRing& ring);
+
+//Producer side: copy up to `count` samples in, returns how many fit
+size_t write_audio_ring(AudioRing& ring, const float* samples, size_t count);
+
+//Consumer side: copy up to `count` samples out, returns how many were available
+size_t read_audio_ring(AudioRing& ring, float* samples, size_t count);
+
+//Triple buffer holding the newest audio texture. The writer fills the back block and swaps
+//it with the middle one, the reader swaps the middle one into the front when it is newer.
+//Both swaps are a single atomic exchange, so neither side waits and the reader never sees
+//a block that is still being written
+struct LatestBlock {
+    float blocks[3][AUDIO_TEXTURE_SIZE] = {};
+
+    std::atomic<int> middle{1}; //Index of the middle block, FRESH when it hasn't been read yet
+    int back = 0;               //Owned by the writer
+    int front = 2;              //Owned by the reader
+};
+
+//Block the writer may fill, valid until the next publish_latest_block
+float* latest_back_block(LatestBlock& latest);
+
+//Make the back block the newest one
+void publish_latest_block(LatestBlock& latest);
+
+//Newest published block, valid until the next call. Returns true when it changed since the last call
+bool acquire_latest_block(LatestBlock& latest, const float*& block);
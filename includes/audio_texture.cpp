@@ -0,0 +1,58 @@
+#include "audio_texture.h"
+#include "audio_ring.h"
+
+#include <cstring>
+
+static const GLsizeiptr TEXTURE_BYTES = AUDIO_TEXTURE_SIZE * sizeof(float);
+
+int init_audio_texture(AudioTexture& audio) {
+    float silence[AUDIO_TEXTURE_SIZE];
+    for (int i = 0; i < AUDIO_TEXTURE_SIZE; i++)
+        silence[i] = i < AUDIO_BLOCK_SIZE ? 0.0f : 0.5f;
+
+    glGenTextures(1, &audio.texture);
+    glBindTexture(GL_TEXTURE_2D, audio.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, AUDIO_BLOCK_SIZE, 2, 0, GL_RED, GL_FLOAT, silence);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenBuffers(2, audio.pbos);
+    for (GLuint pbo : audio.pbos) {
+        glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pbo);
+        glBufferData(GL_PIXEL_UNPACK_BUFFER, TEXTURE_BYTES, nullptr, GL_STREAM_DRAW);
+    }
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+    return 0;
+}
+
+void update_audio_texture(AudioTexture& audio, const float* texels) {
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, audio.pbos[audio.next]);
+
+    //Invalidating lets the driver hand out fresh storage if the last upload from this PBO is still queued
+    void* mapped = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, TEXTURE_BYTES,
+                                    GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+    if (mapped) {
+        memcpy(mapped, texels, TEXTURE_BYTES);
+        glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+        glBindTexture(GL_TEXTURE_2D, audio.texture);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, AUDIO_BLOCK_SIZE, 2, GL_RED, GL_FLOAT, nullptr);
+        glBindTexture(GL_TEXTURE_2D, 0);
+    }
+
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    audio.next = 1 - audio.next;
+}
+
+void destroy_audio_texture(AudioTexture& audio) {
+    if (!audio.texture)
+        return;
+
+    glDeleteTextures(1, &audio.texture);
+    glDeleteBuffers(2, audio.pbos);
+    audio = AudioTexture();
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <glad/glad.h>
+
+//Shadertoy's audio input: a AUDIO_BLOCK_SIZE x 2 single channel texture, spectrum in row 0
+//(sample at y = 0.25) and waveform in row 1 (y = 0.75). Uploads go through two pixel buffer
+//objects used in turn, so the copy is queued behind the draws instead of stalling them
+struct AudioTexture {
+    GLuint texture = 0;
+    GLuint pbos[2] = {0, 0};
+    int next = 0; //PBO the next upload goes through
+};
+
+//Create the texture as silence: empty spectrum, flat waveform
+int init_audio_texture(AudioTexture& audio);
+
+//Upload AUDIO_TEXTURE_SIZE texels laid out as the texture rows
+void update_audio_texture(AudioTexture& audio, const float* texels);
+
+void destroy_audio_texture(AudioTexture& audio);
@@ -0,0 +1,132 @@
+#include "benchmark.h"
+
+#include <algorithm>
+#include <iostream>
+
+//Bins in the frame-time histograms
+static const int histogramBins = 20;
+
+int init_benchmark(Benchmark& bench, int slots) {
+    if (slots < 1) {
+        std::cerr << "Benchmark needs at least one timer query" << std::endl;
+        return -1;
+    }
+
+    bench.queries.assign(slots, 0);
+    glGenQueries(slots, bench.queries.data());
+    bench.head = 0;
+    bench.pending = 0;
+
+    return 0;
+}
+
+//Read back the oldest query if it is done, or wait for it when `block` is set
+static bool collect_oldest(Benchmark& bench, bool block) {
+    int slots = static_cast<int>(bench.queries.size());
+    GLuint query = bench.queries[(bench.head - bench.pending + slots) % slots];
+
+    if (!block) {
+        GLint available = 0;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available)
+            return false;
+    }
+
+    GLuint64 nanoseconds = 0;
+    glGetQueryObjectui64v(query, GL_QUERY_RESULT, &nanoseconds);
+    bench.gpuTimes.push_back(nanoseconds / 1e6);
+
+    bench.pending--;
+    return true;
+}
+
+void begin_gpu_timer(Benchmark& bench) {
+    int slots = static_cast<int>(bench.queries.size());
+
+    while (bench.pending > 0 && collect_oldest(bench, false)) {}
+
+    //Every query is still in flight, the oldest has to finish before it can be reused
+    if (bench.pending == slots)
+        collect_oldest(bench, true);
+
+    glBeginQuery(GL_TIME_ELAPSED, bench.queries[bench.head]);
+}
+
+void end_gpu_timer(Benchmark& bench) {
+    glEndQuery(GL_TIME_ELAPSED);
+
+    bench.head = (bench.head + 1) % static_cast<int>(bench.queries.size());
+    bench.pending++;
+}
+
+void record_cpu_time(Benchmark& bench, double milliseconds) {
+    bench.cpuTimes.push_back(milliseconds);
+}
+
+void finish_benchmark(Benchmark& bench) {
+    while (bench.pending > 0)
+        collect_oldest(bench, true);
+
+    if (!bench.queries.empty())
+        glDeleteQueries(static_cast<GLsizei>(bench.queries.size()), bench.queries.data());
+    bench.queries.clear();
+}
+
+//Nearest-rank percentile of sorted samples
+static double percentile(const std::vector<double>& sorted, double p) {
+    size_t rank = static_cast<size_t>(p / 100.0 * sorted.size() + 0.5);
+    rank = std::min(std::max(rank, static_cast<size_t>(1)), sorted.size());
+    return sorted[rank - 1];
+}
+
+static void write_stats(const char* name, std::vector<double> times, std::ostream& out) {
+    out << "  \"" << name << "\": {";
+    if (times.empty()) {
+        out << "}";
+        return;
+    }
+
+    std::vector<double> samples = times;
+    std::sort(times.begin(), times.end());
+
+    double sum = 0.0;
+    for (double t : times)
+        sum += t;
+
+    double lo = times.front();
+    double hi = times.back();
+    double binWidth = (hi - lo) / histogramBins;
+
+    std::vector<unsigned long> counts(histogramBins, 0);
+    for (double t : times) {
+        int bin = binWidth > 0.0 ? static_cast<int>((t - lo) / binWidth) : 0;
+        counts[std::min(bin, histogramBins - 1)]++;
+    }
+
+    out << "\n    \"min\": " << lo
+        << ",\n    \"median\": " << percentile(times, 50.0)
+        << ",\n    \"p95\": " << percentile(times, 95.0)
+        << ",\n    \"p99\": " << percentile(times, 99.0)
+        << ",\n    \"max\": " << hi
+        << ",\n    \"mean\": " << sum / times.size()
+        << ",\n    \"histogram\": {\"start\": " << lo << ", \"bin_width\": " << binWidth << ", \"counts\": [";
+
+    for (int i = 0; i < histogramBins; i++)
+        out << (i ? ", " : "") << counts[i];
+
+    out << "]},\n    \"samples\": [";
+    for (size_t i = 0; i < samples.size(); i++)
+        out << (i ? ", " : "") << samples[i];
+
+    out << "]\n  }";
+}
+
+void write_benchmark_json(const Benchmark& bench, std::ostream& out) {
+    out << "{\n"
+        << "  \"frames\": " << bench.cpuTimes.size() << ",\n"
+        << "  \"unit\": \"ms\",\n";
+    write_stats("gpu", bench.gpuTimes, out);
+    out << ",\n";
+    write_stats("cpu", bench.cpuTimes, out);
+    out << "\n}" << std::endl;
+}
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <ostream>
+#include <vector>
+
+//Frame timing for --benchmark. GPU time comes from GL_TIME_ELAPSED queries kept in a ring,
+//a query is only read back once its result is available (or its slot is needed again),
+//so measuring never stalls the pipeline. CPU time is the wall time of each loop iteration
+struct Benchmark {
+    std::vector<GLuint> queries;
+    int head = 0;    //Next query to begin
+    int pending = 0; //Queries ended but not read back
+
+    std::vector<double> gpuTimes; //Milliseconds
+    std::vector<double> cpuTimes; //Milliseconds
+};
+
+int init_benchmark(Benchmark& bench, int slots);
+
+//Bracket the draw(s) to time. Only one timer can be active at a time
+void begin_gpu_timer(Benchmark& bench);
+void end_gpu_timer(Benchmark& bench);
+
+void record_cpu_time(Benchmark& bench, double milliseconds);
+
+//Wait for every outstanding query and release them
+void finish_benchmark(Benchmark& bench);
+
+//min/median/p95/p99/max, a histogram and every sample in frame order for GPU and CPU times as JSON
+void write_benchmark_json(const Benchmark& bench, std::ostream& out);
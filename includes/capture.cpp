@@ -0,0 +1,233 @@
+#include "capture.h"
+#include "image_io.h"
+
+#include <algorithm>
+#include <iostream>
+#include <cstdio>
+#include <unistd.h>
+
+int init_capture(CaptureRing& ring, int slots, int width, int height, CaptureLayout layout,
+                 FrameConsumer consumer, void* userData) {
+    if (slots < 1) {
+        std::cerr << "Capture ring needs at least one slot" << std::endl;
+        return -1;
+    }
+
+    ring.width = width;
+    ring.height = height;
+
+    size_t lumaBytes = static_cast<size_t>(width) * height;
+    if (layout == CAPTURE_YUV420) {
+        //YuvPass keeps luma in the first `height` rows and U|V side by side in the rows above,
+        //three reads pack them into contiguous planes
+        int chromaWidth = width / 2;
+        int chromaHeight = height / 2;
+        size_t chromaBytes = static_cast<size_t>(chromaWidth) * chromaHeight;
+
+        ring.regions = {
+            { 0,           0,      width,       height,       GL_RED, 0 },
+            { 0,           height, chromaWidth, chromaHeight, GL_RED, lumaBytes },
+            { chromaWidth, height, chromaWidth, chromaHeight, GL_RED, lumaBytes + chromaBytes },
+        };
+        ring.frameBytes = lumaBytes + chromaBytes * 2;
+    }
+    else {
+        ring.regions = { { 0, 0, width, height, GL_RGBA, 0 } };
+        ring.frameBytes = lumaBytes * 4;
+    }
+    ring.consumer = consumer;
+    ring.userData = userData;
+    ring.head = 0;
+    ring.pending = 0;
+
+    ring.pbos.assign(slots, 0);
+    ring.fences.assign(slots, nullptr);
+
+    glGenBuffers(slots, ring.pbos.data());
+    for (GLuint pbo : ring.pbos) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, ring.frameBytes, nullptr, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    return 0;
+}
+
+//Slot of the oldest frame not yet delivered
+static int oldest_slot(const CaptureRing& ring) {
+    int slots = static_cast<int>(ring.pbos.size());
+    return (ring.head - ring.pending + slots) % slots;
+}
+
+//Wait for the oldest frame's fence (or just poll it when `block` is false) and hand it to the consumer
+static bool deliver_oldest(CaptureRing& ring, bool block) {
+    int slot = oldest_slot(ring);
+    GLsync fence = ring.fences[slot];
+
+    GLuint64 timeout = block ? GL_TIMEOUT_IGNORED : 0;
+    GLenum status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+
+    //glClientWaitSync caps the timeout on some drivers, keep waiting if we have to
+    while (block && status == GL_TIMEOUT_EXPIRED)
+        status = glClientWaitSync(fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+
+    if (status == GL_TIMEOUT_EXPIRED)
+        return false;
+
+    if (status == GL_WAIT_FAILED)
+        std::cerr << "Capture fence wait failed, frame may be incomplete" << std::endl;
+
+    glDeleteSync(fence);
+    ring.fences[slot] = nullptr;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, ring.pbos[slot]);
+    void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, ring.frameBytes, GL_MAP_READ_BIT);
+    if (pixels) {
+        ring.consumer(static_cast<const unsigned char*>(pixels), ring.width, ring.height, ring.userData);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    else {
+        std::cerr << "Failed to map capture buffer" << std::endl;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    ring.pending--;
+    return true;
+}
+
+void capture_frame(CaptureRing& ring, GLuint framebuffer) {
+    int slots = static_cast<int>(ring.pbos.size());
+
+    //Hand over whatever has already landed without stalling
+    while (ring.pending > 0 && deliver_oldest(ring, false)) {}
+
+    //Ring is full, the oldest frame has to be consumed before its slot is reused
+    if (ring.pending == slots)
+        deliver_oldest(ring, true);
+
+    int slot = ring.head;
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+    glReadBuffer(framebuffer ? GL_COLOR_ATTACHMENT0 : GL_BACK);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+
+    //With a pack buffer bound this only queues the copy, the pointer is an offset into the PBO
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, ring.pbos[slot]);
+    for (const CaptureRegion& region : ring.regions) {
+        glReadPixels(region.x, region.y, region.width, region.height, region.format, GL_UNSIGNED_BYTE,
+                     reinterpret_cast<void*>(region.offset));
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    ring.fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+    ring.head = (slot + 1) % slots;
+    ring.pending++;
+}
+
+void flush_capture(CaptureRing& ring) {
+    while (ring.pending > 0)
+        deliver_oldest(ring, true);
+}
+
+void destroy_capture(CaptureRing& ring) {
+    for (GLsync fence : ring.fences) {
+        if (fence)
+            glDeleteSync(fence);
+    }
+
+    if (!ring.pbos.empty())
+        glDeleteBuffers(static_cast<GLsizei>(ring.pbos.size()), ring.pbos.data());
+
+    ring = CaptureRing();
+}
+
+void write_ppm_frame(const unsigned char* pixels, int width, int height, void* userData) {
+    PpmDump* dump = static_cast<PpmDump*>(userData);
+
+    char path[1024];
+    snprintf(path, sizeof(path), "%s_%05lu.ppm", dump->prefix.c_str(), dump->frame++);
+
+    FILE* file = fopen(path, "wb");
+    if (!file) {
+        std::cerr << "Failed to open " << path << " for writing" << std::endl;
+        return;
+    }
+
+    fprintf(file, "P6\n%d %d\n255\n", width, height);
+
+    //PPM is top-down RGB, the capture is bottom-up RGBA
+    dump->row.resize(static_cast<size_t>(width) * 3);
+    for (int y = height - 1; y >= 0; y--) {
+        const unsigned char* src = pixels + static_cast<size_t>(y) * width * 4;
+        for (int x = 0; x < width; x++) {
+            dump->row[x * 3 + 0] = src[x * 4 + 0];
+            dump->row[x * 3 + 1] = src[x * 4 + 1];
+            dump->row[x * 3 + 2] = src[x * 4 + 2];
+        }
+        fwrite(dump->row.data(), 1, dump->row.size(), file);
+    }
+
+    fclose(file);
+}
+
+void compare_frame(const unsigned char* pixels, int width, int height, void* userData) {
+    FrameComparison* comparison = static_cast<FrameComparison*>(userData);
+    unsigned long frame = comparison->frame++;
+
+    char path[1024];
+    Image reference;
+    snprintf(path, sizeof(path), "%s_%05lu.png", comparison->prefix.c_str(), frame);
+    if (access(path, R_OK))
+        snprintf(path, sizeof(path), "%s_%05lu.ppm", comparison->prefix.c_str(), frame);
+    if (load_image(path, reference)) {
+        comparison->missing++;
+        return;
+    }
+
+    //Read the bottom-up capture top-down, like the reference
+    ImageView view;
+    view.width = width;
+    view.height = height;
+    view.stride = -static_cast<ptrdiff_t>(width) * 4;
+    view.pixels = pixels + static_cast<size_t>(height - 1) * width * 4;
+
+    ImageMetrics metrics;
+    if (compare_images(view, image_view(reference), metrics)) {
+        comparison->missing++;
+        return;
+    }
+    comparison->results.push_back(metrics);
+
+    bool failed = comparison->tolerance > 0.0 && metrics.flip > comparison->tolerance;
+    comparison->failed += failed;
+
+    std::cerr << "Frame " << frame << ": PSNR " << metrics.psnr << " dB, SSIM " << metrics.ssim
+              << ", FLIP " << metrics.flip << " (max " << metrics.flipMax << ")"
+              << (failed ? " over tolerance" : "") << std::endl;
+}
+
+int summarize_comparison(const FrameComparison& comparison) {
+    ImageMetrics worst;
+    worst.psnr = PSNR_IDENTICAL;
+    worst.ssim = 1.0;
+    for (const ImageMetrics& metrics : comparison.results) {
+        worst.psnr = std::min(worst.psnr, metrics.psnr);
+        worst.ssim = std::min(worst.ssim, metrics.ssim);
+        worst.flip = std::max(worst.flip, metrics.flip);
+        worst.flipMax = std::max(worst.flipMax, metrics.flipMax);
+    }
+
+    std::cerr << "Compared " << comparison.results.size() << " frames with " << comparison.prefix
+              << ": worst PSNR " << worst.psnr << " dB, SSIM " << worst.ssim << ", FLIP " << worst.flip
+              << " (max " << worst.flipMax << ")";
+    if (comparison.missing)
+        std::cerr << ", " << comparison.missing << " without a reference";
+    if (comparison.tolerance > 0.0)
+        std::cerr << ", " << comparison.failed << " over tolerance " << comparison.tolerance;
+    std::cerr << std::endl;
+
+    if (comparison.tolerance > 0.0 && (comparison.failed || comparison.missing))
+        return -1;
+    return 0;
+}
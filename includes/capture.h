@@ -0,0 +1,83 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+#include <vector>
+
+#include "metrics.h"
+
+//Receives a captured frame in the ring's layout, width and height are the image size.
+//The pixels are only valid for the duration of the call
+typedef void (*FrameConsumer)(const unsigned char* pixels, int width, int height, void* userData);
+
+//What a capture slot holds
+enum CaptureLayout {
+    CAPTURE_RGBA,   //RGBA8 rows bottom-up, as OpenGL reads them
+    CAPTURE_YUV420  //I420 planes read from a YuvPass target (Y, then U, then V, top-down)
+};
+
+//Rectangle of the read framebuffer copied into a slot at a byte offset
+struct CaptureRegion {
+    int x, y, width, height;
+    GLenum format;
+    size_t offset;
+};
+
+//Asynchronous readback through a ring of pixel buffer objects guarded by fences.
+//Frame K is read into slot K % N and only mapped once frame K + N needs the slot
+//(or earlier if its fence has already signalled), so the GPU never waits on the CPU
+struct CaptureRing {
+    int width = 0;
+    int height = 0;
+    size_t frameBytes = 0;
+
+    std::vector<CaptureRegion> regions;
+    std::vector<GLuint> pbos;
+    std::vector<GLsync> fences;
+
+    int head = 0;    //Next slot to read into
+    int pending = 0; //Slots holding frames not yet delivered
+
+    FrameConsumer consumer = nullptr;
+    void* userData = nullptr;
+};
+
+//Allocate a ring of `slots` PBOs for width x height frames
+int init_capture(CaptureRing& ring, int slots, int width, int height, CaptureLayout layout,
+                 FrameConsumer consumer, void* userData);
+
+//Queue a readback of the colour buffer of `framebuffer` (0 for the window's back buffer)
+//and deliver any earlier frames that are ready. For CAPTURE_YUV420 this is the YuvPass framebuffer
+void capture_frame(CaptureRing& ring, GLuint framebuffer);
+
+//Block until every queued frame is delivered
+void flush_capture(CaptureRing& ring);
+
+void destroy_capture(CaptureRing& ring);
+
+//Consumer state for dumping every frame as <prefix>_<frame>.ppm
+struct PpmDump {
+    std::string prefix;
+    unsigned long frame = 0;
+    std::vector<unsigned char> row;
+};
+
+//FrameConsumer writing binary PPMs, userData is a PpmDump
+void write_ppm_frame(const unsigned char* pixels, int width, int height, void* userData);
+
+//Consumer state for comparing every frame with <prefix>_<frame>.png or .ppm, e.g. an earlier --dump-frames
+struct FrameComparison {
+    std::string prefix;
+    unsigned long frame = 0;
+    double tolerance = 0.0;            //Mean perceptual difference a frame may have, 0 accepts any
+    std::vector<ImageMetrics> results; //Of the frames that had a reference
+    unsigned long missing = 0;         //Frames without one
+    unsigned long failed = 0;          //Frames over the tolerance
+};
+
+//FrameConsumer printing PSNR, SSIM and the perceptual difference of each frame, userData is a FrameComparison
+void compare_frame(const unsigned char* pixels, int width, int height, void* userData);
+
+//Print the worst of every metric once the ring is flushed. Returns -1 if a tolerance is set and a
+//frame exceeded it or had no reference
+int summarize_comparison(const FrameComparison& comparison);
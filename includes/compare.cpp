@@ -0,0 +1,31 @@
+#include "compare.h"
+#include "image_io.h"
+#include "metrics.h"
+
+#include <chrono>
+#include <iostream>
+
+int run_compare(const CompareOptions& options) {
+    Image images[2];
+    for (int i = 0; i < 2; i++) {
+        if (load_image(options.paths[i], images[i]))
+            return -1;
+    }
+
+    ImageMetrics metrics;
+    auto start = std::chrono::steady_clock::now();
+    if (compare_images(image_view(images[0]), image_view(images[1]), metrics, options.threads))
+        return -1;
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "{\n"
+              << "  \"size\": [" << images[0].width << ", " << images[0].height << "],\n"
+              << "  \"psnr\": " << metrics.psnr << ",\n"
+              << "  \"ssim\": " << metrics.ssim << ",\n"
+              << "  \"flip\": " << metrics.flip << ",\n"
+              << "  \"flip_max\": " << metrics.flipMax << ",\n"
+              << "  \"kernels\": \"" << metrics_kernels() << "\",\n"
+              << "  \"ms\": " << ms << "\n"
+              << "}" << std::endl;
+    return 0;
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include "options.h"
+
+//`shaded compare`: load both images, compare them with compare_images and print the metrics,
+//the kernels used and the time taken as JSON
+int run_compare(const CompareOptions& options);
@@ -0,0 +1,165 @@
+#include "dynamic_resolution.h"
+#include "shader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+//Timings within this fraction of the target leave the scale alone, so it doesn't shimmer
+static const double DEADBAND = 0.05;
+
+//Fraction of the way to the estimated scale taken per measurement. Results arrive a few
+//frames late, jumping all the way would overshoot
+static const float GAIN = 0.3f;
+
+static const char* upscaleFragmentSource =
+R"(#version 330 core
+uniform sampler2D source;
+uniform vec2 sourceRegion;
+uniform vec2 texel;
+uniform float sharpness;
+in vec2 texCoord;
+out vec4 fragColor;
+
+//Bilinear taps stay inside the rendered corner, the rest of the target is stale
+vec4 fetch(vec2 uv) {
+    return texture(source, clamp(uv, texel * 0.5, sourceRegion - texel * 0.5));
+}
+
+void main() {
+    vec2 uv = texCoord * sourceRegion;
+    vec4 color = fetch(uv);
+
+    if (sharpness > 0.0) {
+        vec4 blur = (fetch(uv + vec2(texel.x, 0.0)) + fetch(uv - vec2(texel.x, 0.0))
+                   + fetch(uv + vec2(0.0, texel.y)) + fetch(uv - vec2(0.0, texel.y))) * 0.25;
+        color.rgb = clamp(color.rgb + (color.rgb - blur.rgb) * sharpness, 0.0, 1.0);
+    }
+    fragColor = color;
+})";
+
+static bool allocate_target(DynamicResolution& dr, int width, int height) {
+    glBindTexture(GL_TEXTURE_2D, dr.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, dr.framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, dr.texture, 0);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete)
+        std::cerr << "Dynamic resolution framebuffer is not complete at " << width << "x" << height << std::endl;
+
+    dr.width = width;
+    dr.height = height;
+    dr.allocated = complete;
+    return complete;
+}
+
+int init_dynamic_resolution(DynamicResolution& dr, int width, int height, double targetMs, float minScale, float sharpen) {
+    if (targetMs <= 0.0 || minScale <= 0.0f || minScale > 1.0f) {
+        std::cerr << "Dynamic resolution needs a positive target time and a minimum scale in (0, 1]" << std::endl;
+        return -1;
+    }
+
+    dr.targetMs = targetMs;
+    dr.minScale = minScale;
+    dr.sharpen = sharpen;
+    dr.scale = 1.0f;
+
+    dr.program = create_program(upscaleFragmentSource);
+    if (!dr.program)
+        return -1;
+
+    glUseProgram(dr.program);
+    glUniform1i(glGetUniformLocation(dr.program, "source"), 0);
+    dr.sourceRegionLocation = glGetUniformLocation(dr.program, "sourceRegion");
+    dr.texelLocation = glGetUniformLocation(dr.program, "texel");
+    dr.sharpnessLocation = glGetUniformLocation(dr.program, "sharpness");
+
+    glGenTextures(1, &dr.texture);
+    glGenFramebuffers(1, &dr.framebuffer);
+    if (!allocate_target(dr, width, height)) {
+        destroy_dynamic_resolution(dr);
+        return -1;
+    }
+
+    init_gpu_timer(dr.timer);
+    return 0;
+}
+
+//Feed every finished measurement to the controller
+static void collect_timings(DynamicResolution& dr) {
+    double ms, scale;
+    while (read_gpu_range(dr.timer, ms, scale)) {
+        if (ms <= 0.0 || std::fabs(ms - dr.targetMs) < dr.targetMs * DEADBAND)
+            continue;
+
+        //Cost goes with the pixel count, so the scale that would have hit the target goes with its root
+        float estimate = static_cast<float>(scale * std::sqrt(dr.targetMs / ms));
+        dr.scale += (estimate - dr.scale) * GAIN;
+        dr.scale = std::min(std::max(dr.scale, dr.minScale), 1.0f);
+    }
+}
+
+bool begin_dynamic_resolution(DynamicResolution& dr, const FrameState& state, FrameState& scaled) {
+    int width = static_cast<int>(state.width);
+    int height = static_cast<int>(state.height);
+    if (width != dr.width || height != dr.height)
+        allocate_target(dr, width, height);
+
+    scaled = state;
+    if (!dr.allocated)
+        return false;
+
+    collect_timings(dr);
+
+    dr.renderWidth = std::max(1, static_cast<int>(std::lround(dr.width * dr.scale)));
+    dr.renderHeight = std::max(1, static_cast<int>(std::lround(dr.height * dr.scale)));
+
+    begin_gpu_range(dr.timer);
+
+    scaled.width = static_cast<float>(dr.renderWidth);
+    scaled.height = static_cast<float>(dr.renderHeight);
+    scaled.mouseX = state.mouseX * dr.renderWidth / dr.width;
+    scaled.mouseY = state.mouseY * dr.renderHeight / dr.height;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, dr.framebuffer);
+    glViewport(0, 0, dr.renderWidth, dr.renderHeight);
+    return true;
+}
+
+void end_dynamic_resolution(DynamicResolution& dr, GLuint framebuffer, GLuint VAO) {
+    //Sharpening only makes up for upscaling, at full size the pass is a plain copy
+    float upscaled = dr.minScale < 1.0f ? (1.0f - dr.scale) / (1.0f - dr.minScale) : 0.0f;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, dr.width, dr.height);
+    glUseProgram(dr.program);
+    glUniform2f(dr.sourceRegionLocation, static_cast<float>(dr.renderWidth) / dr.width,
+                static_cast<float>(dr.renderHeight) / dr.height);
+    glUniform2f(dr.texelLocation, 1.0f / dr.width, 1.0f / dr.height);
+    glUniform1f(dr.sharpnessLocation, dr.sharpen * upscaled);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, dr.texture);
+    glBindVertexArray(VAO);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+
+    end_gpu_range(dr.timer, dr.scale);
+}
+
+void destroy_dynamic_resolution(DynamicResolution& dr) {
+    if (dr.program)
+        glDeleteProgram(dr.program);
+    if (dr.framebuffer)
+        glDeleteFramebuffers(1, &dr.framebuffer);
+    if (dr.texture)
+        glDeleteTextures(1, &dr.texture);
+    destroy_gpu_timer(dr.timer);
+
+    dr = DynamicResolution();
+}
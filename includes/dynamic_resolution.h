@@ -0,0 +1,48 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "uniforms.h"
+#include "gpu_timer.h"
+
+//Dynamic resolution for the image pass. The shader renders into the lower left corner of a
+//window-sized target at `scale` times the window size, then an upscale pass (bilinear, optionally
+//sharpened) draws that corner to the output. GPU time of the image and upscale passes is measured
+//with GL_TIMESTAMP queries, which don't collide with --benchmark's GL_TIME_ELAPSED timer, and
+//each result moves the scale towards the one that would have hit the target, assuming cost
+//proportional to pixel count. Buffer passes keep the full size, resizing them restarts them
+struct DynamicResolution {
+    GLuint program = 0;
+    GLint sourceRegionLocation = -1; //Rendered size / target size
+    GLint texelLocation = -1;        //1 / target size
+    GLint sharpnessLocation = -1;
+
+    GLuint framebuffer = 0;
+    GLuint texture = 0;
+    int width = 0;  //Target (and output) size
+    int height = 0;
+    bool allocated = false; //False after a resize the target couldn't follow, until the next one
+    int renderWidth = 0; //Size the shader renders at this frame
+    int renderHeight = 0;
+
+    double targetMs = 0.0;
+    float minScale = 0.25f;
+    float scale = 1.0f;
+    float sharpen = 0.0f; //Unsharp mask strength at minScale, fading to none at full size
+
+    GpuTimer timer; //Tagged with the scale each frame rendered at
+};
+
+int init_dynamic_resolution(DynamicResolution& dr, int width, int height, double targetMs, float minScale, float sharpen);
+
+//Adapt the scale to the timings that came back, start timing and bind the render target.
+//`scaled` gets `state` with iResolution and iMouse in render target pixels. Returns false, with
+//`scaled` a copy of `state`, when the target couldn't be resized: render this frame straight into
+//the output and skip end_dynamic_resolution
+bool begin_dynamic_resolution(DynamicResolution& dr, const FrameState& state, FrameState& scaled);
+
+//Upscale into `framebuffer` with the quad in `VAO` and stop timing.
+//Leaves the upscale program bound, texture unit 0 changed and the viewport at the output size
+void end_dynamic_resolution(DynamicResolution& dr, GLuint framebuffer, GLuint VAO);
+
+void destroy_dynamic_resolution(DynamicResolution& dr);
@@ -0,0 +1,193 @@
+#include "fft.h"
+
+#include <cmath>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+//Lane types the butterflies are written against: one float at a time, or the widest float
+//vector the target has. Stages with fewer points per twiddle than a vector holds use ScalarLane
+struct ScalarLane {
+    typedef float Type;
+    static const int WIDTH = 1;
+    static Type load(const float* p) { return *p; }
+    static void store(float* p, Type v) { *p = v; }
+    static Type set(float x) { return x; }
+    static Type add(Type a, Type b) { return a + b; }
+    static Type sub(Type a, Type b) { return a - b; }
+    static Type mul(Type a, Type b) { return a * b; }
+};
+
+#if defined(__AVX__)
+struct VectorLane {
+    typedef __m256 Type;
+    static const int WIDTH = 8;
+    static Type load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, Type v) { _mm256_storeu_ps(p, v); }
+    static Type set(float x) { return _mm256_set1_ps(x); }
+    static Type add(Type a, Type b) { return _mm256_add_ps(a, b); }
+    static Type sub(Type a, Type b) { return _mm256_sub_ps(a, b); }
+    static Type mul(Type a, Type b) { return _mm256_mul_ps(a, b); }
+};
+#elif defined(__SSE2__)
+struct VectorLane {
+    typedef __m128 Type;
+    static const int WIDTH = 4;
+    static Type load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, Type v) { _mm_storeu_ps(p, v); }
+    static Type set(float x) { return _mm_set1_ps(x); }
+    static Type add(Type a, Type b) { return _mm_add_ps(a, b); }
+    static Type sub(Type a, Type b) { return _mm_sub_ps(a, b); }
+    static Type mul(Type a, Type b) { return _mm_mul_ps(a, b); }
+};
+#elif defined(__ARM_NEON)
+struct VectorLane {
+    typedef float32x4_t Type;
+    static const int WIDTH = 4;
+    static Type load(const float* p) { return vld1q_f32(p); }
+    static void store(float* p, Type v) { vst1q_f32(p, v); }
+    static Type set(float x) { return vdupq_n_f32(x); }
+    static Type add(Type a, Type b) { return vaddq_f32(a, b); }
+    static Type sub(Type a, Type b) { return vsubq_f32(a, b); }
+    static Type mul(Type a, Type b) { return vmulq_f32(a, b); }
+};
+#else
+typedef ScalarLane VectorLane;
+#endif
+
+//One radix-4 Stockham stage: sequences of length n at stride s become length n/4 at stride 4s.
+//For each butterfly p the s points q share their twiddles, which is what gets vectorized
+template <typename L>
+static void radix4_stage(int n, int s, const float* xr, const float* xi, float* yr, float* yi, const float* twiddles) {
+    typedef typename L::Type V;
+    const int m = n / 4;
+
+    for (int p = 0; p < m; p++) {
+        const float* w = twiddles + 6 * p;
+        V w1r = L::set(w[0]), w1i = L::set(w[1]);
+        V w2r = L::set(w[2]), w2i = L::set(w[3]);
+        V w3r = L::set(w[4]), w3i = L::set(w[5]);
+
+        const int a = s * p, b = s * (p + m), c = s * (p + 2 * m), d = s * (p + 3 * m);
+        const int out = s * 4 * p;
+
+        for (int q = 0; q < s; q += L::WIDTH) {
+            V ar = L::load(xr + a + q), ai = L::load(xi + a + q);
+            V br = L::load(xr + b + q), bi = L::load(xi + b + q);
+            V cr = L::load(xr + c + q), ci = L::load(xi + c + q);
+            V dr = L::load(xr + d + q), di = L::load(xi + d + q);
+
+            V apcR = L::add(ar, cr), apcI = L::add(ai, ci);
+            V amcR = L::sub(ar, cr), amcI = L::sub(ai, ci);
+            V bpdR = L::add(br, dr), bpdI = L::add(bi, di);
+            V bmdR = L::sub(br, dr), bmdI = L::sub(bi, di);
+
+            //X0 = (a+c)+(b+d), X1 = (a-c)-j(b-d), X2 = (a+c)-(b+d), X3 = (a-c)+j(b-d)
+            V x1r = L::add(amcR, bmdI), x1i = L::sub(amcI, bmdR);
+            V x2r = L::sub(apcR, bpdR), x2i = L::sub(apcI, bpdI);
+            V x3r = L::sub(amcR, bmdI), x3i = L::add(amcI, bmdR);
+
+            L::store(yr + out + q, L::add(apcR, bpdR));
+            L::store(yi + out + q, L::add(apcI, bpdI));
+            L::store(yr + out + s + q, L::sub(L::mul(x1r, w1r), L::mul(x1i, w1i)));
+            L::store(yi + out + s + q, L::add(L::mul(x1r, w1i), L::mul(x1i, w1r)));
+            L::store(yr + out + 2 * s + q, L::sub(L::mul(x2r, w2r), L::mul(x2i, w2i)));
+            L::store(yi + out + 2 * s + q, L::add(L::mul(x2r, w2i), L::mul(x2i, w2r)));
+            L::store(yr + out + 3 * s + q, L::sub(L::mul(x3r, w3r), L::mul(x3i, w3i)));
+            L::store(yi + out + 3 * s + q, L::add(L::mul(x3r, w3i), L::mul(x3i, w3r)));
+        }
+    }
+}
+
+//Final radix-2 stage for odd log2 sizes, n == 2 so the only twiddle is 1
+template <typename L>
+static void radix2_stage(int s, const float* xr, const float* xi, float* yr, float* yi) {
+    typedef typename L::Type V;
+
+    for (int q = 0; q < s; q += L::WIDTH) {
+        V ar = L::load(xr + q), ai = L::load(xi + q);
+        V br = L::load(xr + s + q), bi = L::load(xi + s + q);
+        L::store(yr + q, L::add(ar, br));
+        L::store(yi + q, L::add(ai, bi));
+        L::store(yr + s + q, L::sub(ar, br));
+        L::store(yi + s + q, L::sub(ai, bi));
+    }
+}
+
+template <int N>
+RealFft<N>::RealFft() {
+    //Radix-4 stages have n = HALF, HALF/4, ... down to 4 (or 8 before the radix-2 stage)
+    float* w = stageTwiddles;
+    for (int n = HALF; n >= 4; n /= 4) {
+        for (int p = 0; p < n / 4; p++) {
+            for (int k = 1; k <= 3; k++) {
+                double angle = -2.0 * M_PI * k * p / n;
+                *w++ = static_cast<float>(cos(angle));
+                *w++ = static_cast<float>(sin(angle));
+            }
+        }
+    }
+
+    for (int k = 0; k < HALF; k++) {
+        double angle = -2.0 * M_PI * k / N;
+        splitRe[k] = static_cast<float>(cos(angle));
+        splitIm[k] = static_cast<float>(sin(angle));
+    }
+}
+
+template <int N>
+void RealFft<N>::forward(const float* input, float* re, float* im) {
+    //Even samples as the real part, odd ones as the imaginary part
+    int src = 0;
+    for (int i = 0; i < HALF; i++) {
+        workRe[0][i] = input[2 * i];
+        workIm[0][i] = input[2 * i + 1];
+    }
+
+    const float* w = stageTwiddles;
+    int n = HALF, s = 1;
+    for (; n >= 4; n /= 4, s *= 4) {
+        if (s >= VectorLane::WIDTH)
+            radix4_stage<VectorLane>(n, s, workRe[src], workIm[src], workRe[1 - src], workIm[1 - src], w);
+        else
+            radix4_stage<ScalarLane>(n, s, workRe[src], workIm[src], workRe[1 - src], workIm[1 - src], w);
+
+        w += 6 * (n / 4);
+        src = 1 - src;
+    }
+    if (n == 2) {
+        radix2_stage<VectorLane>(s, workRe[src], workIm[src], workRe[1 - src], workIm[1 - src]);
+        src = 1 - src;
+    }
+
+    //Split the half size spectrum Z into the real spectrum X:
+    //X[k] = (Z[k] + conj(Z[HALF-k])) / 2 - j * W^k * (Z[k] - conj(Z[HALF-k])) / 2
+    const float* zr = workRe[src];
+    const float* zi = workIm[src];
+
+    re[0] = zr[0] + zi[0];
+    im[0] = 0.0f;
+    re[HALF] = zr[0] - zi[0];
+    im[HALF] = 0.0f;
+
+    for (int k = 1; k < HALF; k++) {
+        float evenR = 0.5f * (zr[k] + zr[HALF - k]);
+        float evenI = 0.5f * (zi[k] - zi[HALF - k]);
+        float oddR = 0.5f * (zi[k] + zi[HALF - k]);
+        float oddI = -0.5f * (zr[k] - zr[HALF - k]);
+
+        re[k] = evenR + splitRe[k] * oddR - splitIm[k] * oddI;
+        im[k] = evenI + splitRe[k] * oddI + splitIm[k] * oddR;
+    }
+}
+
+template struct RealFft<256>;
+template struct RealFft<512>;
+template struct RealFft<1024>;
+template struct RealFft<2048>;
+template struct RealFft<4096>;
@@ -0,0 +1,40 @@
+#pragma once
+
+//Forward FFT of N real samples, N a power of two between 256 and 4096. Each size is its own
+//instantiation, so stage counts and table sizes are compile time constants.
+//
+//The real input is transformed as N/2 complex points followed by a split step. The complex
+//transform is a Stockham autosort FFT (no bit reversal pass) made of radix-4 stages plus one
+//radix-2 stage when log2(N/2) is odd. Data is kept as separate real and imaginary arrays so
+//a stage runs the same butterfly over consecutive points with SIMD: AVX, SSE2 or NEON,
+//whichever the compiler targets, with a scalar fallback
+template <int N>
+struct RealFft {
+    static_assert(N >= 256 && N <= 4096 && (N & (N - 1)) == 0, "RealFft sizes are powers of two from 256 to 4096");
+
+    static const int HALF = N / 2;     //Points of the complex transform
+    static const int BINS = N / 2 + 1; //Output bins, DC to Nyquist
+
+    //Per radix-4 stage and butterfly index: w1, w2, w3 as re/im pairs
+    alignas(32) float stageTwiddles[3 * HALF];
+
+    //e^(-2*pi*i*k/N) for the split step
+    alignas(32) float splitRe[HALF];
+    alignas(32) float splitIm[HALF];
+
+    //Ping-pong work buffers
+    alignas(32) float workRe[2][HALF];
+    alignas(32) float workIm[2][HALF];
+
+    RealFft();
+
+    //Transform N samples into BINS complex bins, `re` and `im` hold BINS floats each
+    void forward(const float* input, float* re, float* im);
+};
+
+//Instantiated in fft.cpp
+extern template struct RealFft<256>;
+extern template struct RealFft<512>;
+extern template struct RealFft<1024>;
+extern template struct RealFft<2048>;
+extern template struct RealFft<4096>;
@@ -0,0 +1,435 @@
+#include "flac.h"
+
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+
+//Channel assignments beyond independent channels
+static const int LEFT_SIDE = 8;
+static const int RIGHT_SIDE = 9;
+static const int MID_SIDE = 10;
+
+static bool fill_buffer(FlacDecoder& flac) {
+    flac.bufferFill = fread(flac.buffer.data(), 1, flac.buffer.size(), flac.file);
+    flac.bufferPos = 0;
+    if (!flac.bufferFill)
+        flac.endOfFile = true;
+    return flac.bufferFill > 0;
+}
+
+//Read up to 32 bits, most significant first. Past the end of the file reads zeros and sets endOfFile
+static uint32_t read_bits(FlacDecoder& flac, int count) {
+    while (flac.cacheBits < count) {
+        int byte = 0;
+        if (flac.bufferPos < flac.bufferFill || fill_buffer(flac))
+            byte = flac.buffer[flac.bufferPos++];
+
+        flac.cache = (flac.cache << 8) | byte;
+        flac.cacheBits += 8;
+    }
+
+    flac.cacheBits -= count;
+    return static_cast<uint32_t>((flac.cache >> flac.cacheBits) & ((1ull << count) - 1));
+}
+
+static int32_t read_signed(FlacDecoder& flac, int count) {
+    if (!count)
+        return 0;
+
+    int64_t value = read_bits(flac, count);
+    if (value & (1ll << (count - 1)))
+        value -= 1ll << count;
+    return static_cast<int32_t>(value);
+}
+
+//Count the zeros before the next one bit and skip past it
+static uint32_t read_unary(FlacDecoder& flac) {
+    uint32_t zeros = 0;
+
+    for (;;) {
+        if (!flac.cacheBits) {
+            if (flac.bufferPos == flac.bufferFill && !fill_buffer(flac))
+                return zeros;
+            flac.cache = flac.buffer[flac.bufferPos++];
+            flac.cacheBits = 8;
+        }
+
+        uint64_t bits = flac.cache & ((1ull << flac.cacheBits) - 1);
+        if (!bits) {
+            zeros += flac.cacheBits;
+            flac.cacheBits = 0;
+            continue;
+        }
+
+        int top = 63 - __builtin_clzll(bits);
+        zeros += flac.cacheBits - 1 - top;
+        flac.cacheBits = top;
+        return zeros;
+    }
+}
+
+static void align_to_byte(FlacDecoder& flac) {
+    flac.cacheBits -= flac.cacheBits % 8;
+}
+
+//Skip whole bytes, seeking over what isn't buffered (e.g. embedded cover art)
+static void skip_bytes(FlacDecoder& flac, uint64_t count) {
+    for (; count && flac.cacheBits >= 8; count--)
+        flac.cacheBits -= 8;
+
+    uint64_t buffered = std::min<uint64_t>(count, flac.bufferFill - flac.bufferPos);
+    flac.bufferPos += buffered;
+    count -= buffered;
+
+    if (count)
+        fseek(flac.file, static_cast<long>(count), SEEK_CUR);
+}
+
+//Partitioned Rice coded residual of a predicted subframe, written after the `order` warm-up samples
+static bool decode_residual(FlacDecoder& flac, int32_t* out, int blockSize, int order) {
+    uint32_t method = read_bits(flac, 2);
+    if (method > 1)
+        return false;
+
+    int parameterBits = method ? 5 : 4;
+    uint32_t escape = method ? 31 : 15;
+
+    int partitionOrder = read_bits(flac, 4);
+    int perPartition = blockSize >> partitionOrder;
+    if (perPartition < order || (perPartition << partitionOrder) != blockSize)
+        return false;
+
+    int i = order;
+    for (int partition = 0; partition < (1 << partitionOrder); partition++) {
+        int count = perPartition - (partition ? 0 : order);
+        uint32_t parameter = read_bits(flac, parameterBits);
+
+        if (parameter == escape) {
+            int rawBits = read_bits(flac, 5);
+            for (int n = 0; n < count; n++)
+                out[i++] = read_signed(flac, rawBits);
+            continue;
+        }
+
+        for (int n = 0; n < count; n++) {
+            uint32_t value = (read_unary(flac) << parameter) | read_bits(flac, parameter);
+            out[i++] = static_cast<int32_t>(value >> 1) ^ -static_cast<int32_t>(value & 1);
+        }
+    }
+    return true;
+}
+
+static bool decode_subframe(FlacDecoder& flac, int32_t* out, int blockSize, int bitsPerSample) {
+    read_bits(flac, 1); //Zero padding
+    int type = read_bits(flac, 6);
+
+    //Low bits that are zero in every sample of the block aren't stored
+    int wasted = 0;
+    if (read_bits(flac, 1))
+        wasted = read_unary(flac) + 1;
+    bitsPerSample -= wasted;
+    if (bitsPerSample <= 0 || bitsPerSample > 32)
+        return false;
+
+    if (type == 0) {
+        int32_t value = read_signed(flac, bitsPerSample);
+        std::fill(out, out + blockSize, value);
+    }
+    else if (type == 1) {
+        for (int i = 0; i < blockSize; i++)
+            out[i] = read_signed(flac, bitsPerSample);
+    }
+    else if (type >= 8 && type <= 12) {
+        int order = type - 8;
+        if (order > blockSize)
+            return false;
+        for (int i = 0; i < order; i++)
+            out[i] = read_signed(flac, bitsPerSample);
+        if (!decode_residual(flac, out, blockSize, order))
+            return false;
+
+        //Fixed polynomial predictors of order 0-4
+        for (int i = order; i < blockSize; i++) {
+            int64_t prediction = 0;
+            switch (order) {
+                case 1: prediction = out[i - 1]; break;
+                case 2: prediction = 2ll * out[i - 1] - out[i - 2]; break;
+                case 3: prediction = 3ll * out[i - 1] - 3ll * out[i - 2] + out[i - 3]; break;
+                case 4: prediction = 4ll * out[i - 1] - 6ll * out[i - 2] + 4ll * out[i - 3] - out[i - 4]; break;
+                default: break;
+            }
+            out[i] = static_cast<int32_t>(out[i] + prediction);
+        }
+    }
+    else if (type >= 32) {
+        int order = type - 31;
+        if (order > blockSize)
+            return false;
+        for (int i = 0; i < order; i++)
+            out[i] = read_signed(flac, bitsPerSample);
+
+        int precision = read_bits(flac, 4) + 1;
+        int shift = read_signed(flac, 5);
+        if (precision == 16 || shift < 0)
+            return false;
+
+        int32_t coefficients[32];
+        for (int i = 0; i < order; i++)
+            coefficients[i] = read_signed(flac, precision);
+
+        if (!decode_residual(flac, out, blockSize, order))
+            return false;
+
+        for (int i = order; i < blockSize; i++) {
+            int64_t sum = 0;
+            for (int j = 0; j < order; j++)
+                sum += static_cast<int64_t>(coefficients[j]) * out[i - 1 - j];
+            out[i] = static_cast<int32_t>(out[i] + (sum >> shift));
+        }
+    }
+    else {
+        return false;
+    }
+
+    if (wasted) {
+        for (int i = 0; i < blockSize; i++)
+            out[i] = static_cast<int32_t>(static_cast<uint32_t>(out[i]) << wasted);
+    }
+    return true;
+}
+
+//Byte offset in the file of the next unread byte, the reader has to be byte aligned
+static long stream_position(const FlacDecoder& flac) {
+    return ftell(flac.file) - static_cast<long>(flac.bufferFill - flac.bufferPos) - flac.cacheBits / 8;
+}
+
+//Continue reading at `position`, dropping what is buffered
+static void seek_stream(FlacDecoder& flac, long position) {
+    fseek(flac.file, position, SEEK_SET);
+    flac.bufferFill = 0;
+    flac.bufferPos = 0;
+    flac.cacheBits = 0;
+    flac.endOfFile = false;
+}
+
+//CRC-8 of the frame header, polynomial x^8 + x^2 + x + 1
+static uint8_t crc8(uint8_t crc, uint32_t byte) {
+    crc ^= static_cast<uint8_t>(byte);
+    for (int i = 0; i < 8; i++)
+        crc = static_cast<uint8_t>(crc & 0x80 ? (crc << 1) ^ 0x07 : crc << 1);
+    return crc;
+}
+
+static uint32_t read_header_byte(FlacDecoder& flac, uint8_t& crc) {
+    uint32_t byte = read_bits(flac, 8);
+    crc = crc8(crc, byte);
+    return byte;
+}
+
+//Skip to just past the next 14 bit sync code 11111111111110, byte aligned: FF F8 or FF F9.
+//`second` is the byte after the FF, its low bit is the blocking strategy
+static bool find_sync(FlacDecoder& flac, uint32_t& second) {
+    uint32_t byte = read_bits(flac, 8);
+    while (!flac.endOfFile) {
+        second = read_bits(flac, 8);
+        if (byte == 0xFF && (second & 0xFE) == 0xF8)
+            return true;
+
+        //A second FF can start the code itself
+        byte = second;
+    }
+    return false;
+}
+
+//Parse the frame header following a sync code. False if it doesn't fit the stream or fails its
+//CRC-8, which is what tells a sync code inside frame data from a real frame
+static bool read_frame_header(FlacDecoder& flac, uint32_t second, int& blockSize, int& bitsPerSample,
+                              int& assignment) {
+    uint8_t crc = crc8(crc8(0, 0xFF), second);
+
+    uint32_t byte = read_header_byte(flac, crc);
+    int blockSizeCode = byte >> 4;
+    int sampleRateCode = byte & 15;
+
+    byte = read_header_byte(flac, crc);
+    assignment = byte >> 4;
+    int sampleSizeCode = (byte >> 1) & 7;
+    if (byte & 1)
+        return false;
+
+    //Frame or sample number, UTF-8 style variable length
+    uint32_t first = read_header_byte(flac, crc);
+    int ones = 0;
+    while (ones < 8 && (first & (0x80 >> ones)))
+        ones++;
+    for (int i = 1; i < ones; i++)
+        read_header_byte(flac, crc);
+
+    if (blockSizeCode == 1)
+        blockSize = 192;
+    else if (blockSizeCode >= 2 && blockSizeCode <= 5)
+        blockSize = 576 << (blockSizeCode - 2);
+    else if (blockSizeCode == 6)
+        blockSize = read_header_byte(flac, crc) + 1;
+    else if (blockSizeCode == 7) {
+        blockSize = read_header_byte(flac, crc) << 8;
+        blockSize = (blockSize | read_header_byte(flac, crc)) + 1;
+    }
+    else if (blockSizeCode >= 8)
+        blockSize = 256 << (blockSizeCode - 8);
+    else
+        return false;
+
+    //The stream header has the rate, only skip what the frame header carries
+    if (sampleRateCode == 12)
+        read_header_byte(flac, crc);
+    else if (sampleRateCode == 13 || sampleRateCode == 14) {
+        read_header_byte(flac, crc);
+        read_header_byte(flac, crc);
+    }
+    else if (sampleRateCode == 15)
+        return false;
+
+    static const int sampleSizes[8] = {0, 8, 12, 0, 16, 20, 24, 32};
+    bitsPerSample = sampleSizeCode ? sampleSizes[sampleSizeCode] : flac.bitsPerSample;
+    if (!bitsPerSample)
+        return false;
+
+    int channels = assignment < 8 ? assignment + 1 : 2;
+    if (assignment > MID_SIDE || channels != flac.channels)
+        return false;
+
+    return read_bits(flac, 8) == crc && !flac.endOfFile;
+}
+
+//Find the next frame and decode it into flac.samples. False at the end of the stream or on a corrupt frame
+static bool decode_frame(FlacDecoder& flac) {
+    int blockSize = 0;
+    int bitsPerSample = 0;
+    int assignment = 0;
+
+    //Frames start byte aligned with a sync code. One turning up inside frame data fails the header
+    //check, the search then resumes right after it
+    align_to_byte(flac);
+    for (;;) {
+        uint32_t second = 0;
+        if (!find_sync(flac, second))
+            return false;
+
+        long resume = stream_position(flac);
+        if (read_frame_header(flac, second, blockSize, bitsPerSample, assignment))
+            break;
+        seek_stream(flac, resume);
+    }
+    int channels = assignment < 8 ? assignment + 1 : 2;
+
+    for (int channel = 0; channel < channels; channel++) {
+        //The side channel needs one more bit
+        bool side = (assignment == LEFT_SIDE && channel == 1) || (assignment == RIGHT_SIDE && channel == 0)
+                    || (assignment == MID_SIDE && channel == 1);
+
+        flac.samples[channel].resize(blockSize);
+        if (!decode_subframe(flac, flac.samples[channel].data(), blockSize, bitsPerSample + side))
+            return false;
+    }
+
+    int32_t* a = flac.samples[0].data();
+    int32_t* b = channels > 1 ? flac.samples[1].data() : nullptr;
+    for (int i = 0; i < blockSize && assignment >= LEFT_SIDE; i++) {
+        if (assignment == LEFT_SIDE) {
+            b[i] = a[i] - b[i];
+        }
+        else if (assignment == RIGHT_SIDE) {
+            a[i] += b[i];
+        }
+        else {
+            int64_t mid = a[i] * 2ll | (b[i] & 1);
+            a[i] = static_cast<int32_t>((mid + b[i]) >> 1);
+            b[i] = static_cast<int32_t>((mid - b[i]) >> 1);
+        }
+    }
+
+    align_to_byte(flac);
+    read_bits(flac, 16); //Frame CRC-16
+
+    flac.blockSize = blockSize;
+    flac.blockPos = 0;
+    return !flac.endOfFile;
+}
+
+int open_flac(FlacDecoder& flac, FILE* file) {
+    flac.file = file;
+    flac.buffer.resize(1 << 16);
+
+    if (read_bits(flac, 32) != 0x664C6143) { //"fLaC"
+        std::cerr << "Not a FLAC stream" << std::endl;
+        close_flac(flac);
+        return -1;
+    }
+
+    bool last = false;
+    while (!last && !flac.endOfFile) {
+        last = read_bits(flac, 1);
+        int type = read_bits(flac, 7);
+        uint32_t length = read_bits(flac, 24);
+
+        if (type != 0) {
+            skip_bytes(flac, length);
+            continue;
+        }
+
+        //STREAMINFO, always the first block
+        read_bits(flac, 16); //Min/max block size
+        read_bits(flac, 16);
+        read_bits(flac, 24); //Min/max frame size
+        read_bits(flac, 24);
+        flac.sampleRate = read_bits(flac, 20);
+        flac.channels = read_bits(flac, 3) + 1;
+        flac.bitsPerSample = read_bits(flac, 5) + 1;
+        flac.totalFrames = (static_cast<uint64_t>(read_bits(flac, 4)) << 32) | read_bits(flac, 32);
+        skip_bytes(flac, 16); //MD5 of the decoded audio
+        skip_bytes(flac, length - 34);
+    }
+
+    if (!flac.sampleRate || flac.endOfFile) {
+        std::cerr << "FLAC stream has no STREAMINFO" << std::endl;
+        close_flac(flac);
+        return -1;
+    }
+    return 0;
+}
+
+size_t read_flac_frames(FlacDecoder& flac, float* stereo, size_t frames) {
+    const float scale = static_cast<float>(ldexp(1.0, 1 - flac.bitsPerSample));
+    size_t written = 0;
+
+    while (written < frames) {
+        if (flac.blockPos == flac.blockSize) {
+            //A corrupt frame is skipped, decoding picks up at the next sync code
+            bool decoded = false;
+            while (!decoded && !flac.endOfFile)
+                decoded = decode_frame(flac);
+            if (!decoded)
+                break;
+        }
+
+        size_t count = std::min<size_t>(flac.blockSize - flac.blockPos, frames - written);
+        const int32_t* left = flac.samples[0].data() + flac.blockPos;
+        const int32_t* right = flac.channels > 1 ? flac.samples[1].data() + flac.blockPos : left;
+
+        for (size_t i = 0; i < count; i++) {
+            stereo[2 * (written + i)] = left[i] * scale;
+            stereo[2 * (written + i) + 1] = right[i] * scale;
+        }
+
+        flac.blockPos += count;
+        written += count;
+    }
+    return written;
+}
+
+void close_flac(FlacDecoder& flac) {
+    if (flac.file)
+        fclose(flac.file);
+    flac.file = nullptr;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+//Streaming FLAC decoder: reads one frame at a time from the file, so memory use doesn't
+//depend on the length of the track. Handles every subframe type (constant, verbatim,
+//fixed and LPC predictors) and the stereo decorrelation modes. Frame headers are checked
+//against their CRC-8 to skip false sync codes, the CRC-16 of the frame data is not verified
+struct FlacDecoder {
+    FILE* file = nullptr;
+
+    int sampleRate = 0;
+    int channels = 0;
+    int bitsPerSample = 0;
+    uint64_t totalFrames = 0; //0 when the encoder didn't know
+
+    //Bit reader over a buffered chunk of the file
+    std::vector<unsigned char> buffer;
+    size_t bufferFill = 0;
+    size_t bufferPos = 0;
+    uint64_t cache = 0; //Valid bits are the low `cacheBits`, most significant first
+    int cacheBits = 0;
+    bool endOfFile = false;
+
+    //Last decoded frame
+    std::vector<int32_t> samples[8];
+    int blockSize = 0;
+    int blockPos = 0; //Next sample of the block to hand out
+};
+
+//Read the stream header from `file`, positioned at the "fLaC" marker. Takes ownership of the file
+int open_flac(FlacDecoder& flac, FILE* file);
+
+//Decode up to `frames` sample frames as interleaved stereo floats, returns how many were
+//written, less than `frames` only at the end of the stream
+size_t read_flac_frames(FlacDecoder& flac, float* stereo, size_t frames);
+
+void close_flac(FlacDecoder& flac);
@@ -0,0 +1,179 @@
+#include "foveate.h"
+#include "shader.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+//Width of the blend between two zones, as a fraction of the full resolution radius
+static const float BLEND_BAND = 0.2f;
+
+//Zones sample in frame fractions rather than texels, so contents line up even where a
+//zone's size was rounded up. The full zone is exact pixels, skipped where it isn't visible
+static const char* compositeFragmentSource =
+R"(#version 330 core
+uniform sampler2D zone0;
+uniform sampler2D zone1;
+uniform sampler2D zone2;
+uniform vec2 focus;
+uniform vec2 radii;
+uniform float band;
+uniform vec2 outputSize;
+out vec4 fragColor;
+
+void main() {
+    vec2 uv = gl_FragCoord.xy / outputSize;
+    float d = distance(gl_FragCoord.xy, focus);
+
+    float toHalf = smoothstep(radii.x - band, radii.x, d);
+    float toQuarter = smoothstep(radii.y - band, radii.y, d);
+
+    vec4 color = texture(zone2, uv);
+    if (toQuarter < 1.0)
+        color = mix(texture(zone1, uv), color, toQuarter);
+    if (toHalf < 1.0)
+        color = mix(texelFetch(zone0, ivec2(gl_FragCoord.xy), 0), color, toHalf);
+    fragColor = color;
+})";
+
+static int zone_size(int size, int zone) {
+    return (size + (1 << zone) - 1) >> zone;
+}
+
+static bool allocate_targets(Foveation& fov, int width, int height) {
+    bool complete = true;
+    for (int zone = 0; zone < FOVEATION_ZONES; zone++) {
+        glBindTexture(GL_TEXTURE_2D, fov.textures[zone]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, zone_size(width, zone), zone_size(height, zone), 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, fov.framebuffers[zone]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, fov.textures[zone], 0);
+        complete = complete && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    fov.width = width;
+    fov.height = height;
+    return complete;
+}
+
+int init_foveation(Foveation& fov, float radius, bool followMouse, float focusX, float focusY, int width, int height) {
+    if (radius <= 0.0f || radius > 1.0f) {
+        std::cerr << "Foveation needs a radius in (0, 1] of the frame height" << std::endl;
+        return -1;
+    }
+
+    fov.radius = radius;
+    fov.followMouse = followMouse;
+    fov.focusX = focusX;
+    fov.focusY = focusY;
+
+    fov.program = create_program(compositeFragmentSource);
+    if (!fov.program)
+        return -1;
+
+    glUseProgram(fov.program);
+    glUniform1i(glGetUniformLocation(fov.program, "zone0"), 0);
+    glUniform1i(glGetUniformLocation(fov.program, "zone1"), 1);
+    glUniform1i(glGetUniformLocation(fov.program, "zone2"), 2);
+    fov.focusLocation = glGetUniformLocation(fov.program, "focus");
+    fov.radiiLocation = glGetUniformLocation(fov.program, "radii");
+    fov.bandLocation = glGetUniformLocation(fov.program, "band");
+    fov.outputSizeLocation = glGetUniformLocation(fov.program, "outputSize");
+
+    glGenFramebuffers(FOVEATION_ZONES, fov.framebuffers);
+    glGenTextures(FOVEATION_ZONES, fov.textures);
+    if (!allocate_targets(fov, width, height)) {
+        std::cerr << "Foveation framebuffers are not complete" << std::endl;
+        destroy_foveation(fov);
+        return -1;
+    }
+    return 0;
+}
+
+void render_foveation_zones(Foveation& fov, const UniformTable& uniforms, const FrameState& state, GLuint VAO) {
+    int width = static_cast<int>(state.width);
+    int height = static_cast<int>(state.height);
+    if (width != fov.width || height != fov.height)
+        allocate_targets(fov, width, height);
+
+    //iMouse is in window coordinates, y pointing down
+    if (fov.followMouse) {
+        fov.focus[0] = std::min(std::max(state.mouseX, 0.0f), state.width);
+        fov.focus[1] = std::min(std::max(state.height - state.mouseY, 0.0f), state.height);
+    }
+    else {
+        fov.focus[0] = fov.focusX * state.width;
+        fov.focus[1] = fov.focusY * state.height;
+    }
+    fov.radii[0] = fov.radius * state.height;
+    fov.radii[1] = fov.radii[0] * 2.0f;
+
+    glBindVertexArray(VAO);
+    for (int zone = 0; zone < FOVEATION_ZONES; zone++) {
+        int zoneWidth = zone_size(width, zone);
+        int zoneHeight = zone_size(height, zone);
+        float scale = 1.0f / (1 << zone);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, fov.framebuffers[zone]);
+        glViewport(0, 0, zoneWidth, zoneHeight);
+
+        //Inner zones only shade the box around their circle, with two texels of margin for filtering
+        bool outermost = zone == FOVEATION_ZONES - 1;
+        if (!outermost) {
+            float reach = fov.radii[zone] * scale + 2.0f;
+            int x0 = std::max(0, static_cast<int>(std::floor(fov.focus[0] * scale - reach)));
+            int y0 = std::max(0, static_cast<int>(std::floor(fov.focus[1] * scale - reach)));
+            int x1 = std::min(zoneWidth, static_cast<int>(std::ceil(fov.focus[0] * scale + reach)));
+            int y1 = std::min(zoneHeight, static_cast<int>(std::ceil(fov.focus[1] * scale + reach)));
+
+            glEnable(GL_SCISSOR_TEST);
+            glScissor(x0, y0, std::max(0, x1 - x0), std::max(0, y1 - y0));
+        }
+
+        FrameState zoneState = state;
+        zoneState.width = static_cast<float>(zoneWidth);
+        zoneState.height = static_cast<float>(zoneHeight);
+        zoneState.mouseX = state.mouseX * scale;
+        zoneState.mouseY = state.mouseY * scale;
+        push_frame_uniforms(uniforms, zoneState);
+
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        glDisable(GL_SCISSOR_TEST);
+    }
+}
+
+void composite_foveation(Foveation& fov, GLuint framebuffer, GLuint VAO) {
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glViewport(0, 0, fov.width, fov.height);
+    glUseProgram(fov.program);
+    glUniform2f(fov.focusLocation, fov.focus[0], fov.focus[1]);
+    glUniform2f(fov.radiiLocation, fov.radii[0], fov.radii[1]);
+    glUniform1f(fov.bandLocation, fov.radii[0] * BLEND_BAND);
+    glUniform2f(fov.outputSizeLocation, static_cast<float>(fov.width), static_cast<float>(fov.height));
+
+    for (int zone = 0; zone < FOVEATION_ZONES; zone++) {
+        glActiveTexture(GL_TEXTURE0 + zone);
+        glBindTexture(GL_TEXTURE_2D, fov.textures[zone]);
+    }
+    glActiveTexture(GL_TEXTURE0);
+
+    glBindVertexArray(VAO);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+}
+
+void destroy_foveation(Foveation& fov) {
+    if (fov.program)
+        glDeleteProgram(fov.program);
+    if (fov.framebuffers[0])
+        glDeleteFramebuffers(FOVEATION_ZONES, fov.framebuffers);
+    if (fov.textures[0])
+        glDeleteTextures(FOVEATION_ZONES, fov.textures);
+
+    fov = Foveation();
+}
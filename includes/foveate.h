@@ -0,0 +1,48 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "uniforms.h"
+
+//Full, half and quarter resolution
+const int FOVEATION_ZONES = 3;
+
+//Foveated rendering of the image pass in concentric zones around a focus point: full resolution
+//within `radius`, half resolution (1/4 of the pixels shaded) out to twice that, and quarter
+//resolution (1/16) beyond. Each zone renders into its own target, scissored to the box around
+//its circle, so only the outermost covers the whole frame. A composite pass blends the zones
+//across a band at each boundary so the seams don't show
+struct Foveation {
+    float radius = 0.25f; //Full resolution zone, as a fraction of the frame height
+    bool followMouse = false;
+    float focusX = 0.5f;  //Fixed focus as a fraction of the frame, from the bottom left
+    float focusY = 0.5f;
+
+    GLuint framebuffers[FOVEATION_ZONES] = {0, 0, 0};
+    GLuint textures[FOVEATION_ZONES] = {0, 0, 0};
+    int width = 0; //Output size, zone N is 2^N times smaller
+    int height = 0;
+
+    //This frame's focus and zone radii, in output pixels
+    float focus[2] = {0.0f, 0.0f};
+    float radii[2] = {0.0f, 0.0f};
+
+    GLuint program = 0;
+    GLint focusLocation = -1;
+    GLint radiiLocation = -1;
+    GLint bandLocation = -1;
+    GLint outputSizeLocation = -1;
+};
+
+//`radius` in (0, 1]. Focuses on iMouse when `followMouse` is set, on (focusX, focusY) otherwise
+int init_foveation(Foveation& fov, float radius, bool followMouse, float focusX, float focusY, int width, int height);
+
+//Draw the image pass into each zone with the quad in `VAO`, pushing `uniforms` with the zone's
+//iResolution and iMouse. Call with the image program in use
+void render_foveation_zones(Foveation& fov, const UniformTable& uniforms, const FrameState& state, GLuint VAO);
+
+//Blend the zones into `framebuffer` at full size.
+//Leaves the composite program bound, texture units 0-2 changed and the viewport at the output size
+void composite_foveation(Foveation& fov, GLuint framebuffer, GLuint VAO);
+
+void destroy_foveation(Foveation& fov);
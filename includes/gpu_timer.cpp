@@ -0,0 +1,51 @@
+#include "gpu_timer.h"
+
+void init_gpu_timer(GpuTimer& timer) {
+    glGenQueries(GPU_TIMER_SLOTS * 2, &timer.queries[0][0]);
+    timer.head = 0;
+    timer.pending = 0;
+}
+
+void begin_gpu_range(GpuTimer& timer) {
+    //Every pair still in flight: skip measuring rather than wait
+    timer.measuring = timer.pending < GPU_TIMER_SLOTS;
+    if (timer.measuring)
+        glQueryCounter(timer.queries[timer.head][0], GL_TIMESTAMP);
+}
+
+void end_gpu_range(GpuTimer& timer, double tag) {
+    if (!timer.measuring)
+        return;
+
+    glQueryCounter(timer.queries[timer.head][1], GL_TIMESTAMP);
+    timer.tags[timer.head] = tag;
+    timer.head = (timer.head + 1) % GPU_TIMER_SLOTS;
+    timer.pending++;
+    timer.measuring = false;
+}
+
+bool read_gpu_range(GpuTimer& timer, double& milliseconds, double& tag) {
+    if (!timer.pending)
+        return false;
+
+    int slot = (timer.head - timer.pending + GPU_TIMER_SLOTS) % GPU_TIMER_SLOTS;
+    GLint available = 0;
+    glGetQueryObjectiv(timer.queries[slot][1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available)
+        return false;
+
+    GLuint64 begin = 0, end = 0;
+    glGetQueryObjectui64v(timer.queries[slot][0], GL_QUERY_RESULT, &begin);
+    glGetQueryObjectui64v(timer.queries[slot][1], GL_QUERY_RESULT, &end);
+    timer.pending--;
+
+    milliseconds = (end - begin) / 1e6;
+    tag = timer.tags[slot];
+    return true;
+}
+
+void destroy_gpu_timer(GpuTimer& timer) {
+    if (timer.queries[0][0])
+        glDeleteQueries(GPU_TIMER_SLOTS * 2, &timer.queries[0][0]);
+    timer = GpuTimer();
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <glad/glad.h>
+
+//Measurements in flight, results are read a few frames late so nothing waits on the GPU
+const int GPU_TIMER_SLOTS = 4;
+
+//GPU time of a range of commands from a pair of GL_TIMESTAMP queries, which unlike
+//GL_TIME_ELAPSED may overlap other timers such as --benchmark's. Pairs are kept in a ring and
+//read back once available; a range begun while every pair is in flight isn't measured
+struct GpuTimer {
+    GLuint queries[GPU_TIMER_SLOTS][2] = {};
+    double tags[GPU_TIMER_SLOTS] = {}; //Caller's value at the time of each measurement, e.g. the setting it ran with
+    int head = 0;    //Next pair to begin
+    int pending = 0; //Pairs ended but not read back
+    bool measuring = false;
+};
+
+void init_gpu_timer(GpuTimer& timer);
+
+void begin_gpu_range(GpuTimer& timer);
+void end_gpu_range(GpuTimer& timer, double tag);
+
+//Oldest finished measurement, returns false if none is ready
+bool read_gpu_range(GpuTimer& timer, double& milliseconds, double& tag);
+
+void destroy_gpu_timer(GpuTimer& timer);
@@ -0,0 +1,202 @@
+#include "headless.h"
+
+#include <iostream>
+#include <cstring>
+#include <glad/glad.h>
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+//Check whether an extension is in an EGL extension string
+static bool has_extension(const char* extensions, const char* name) {
+    if (!extensions)
+        return false;
+
+    size_t len = strlen(name);
+    for (const char* p = strstr(extensions, name); p; p = strstr(p + len, name)) {
+        //Make sure it isn't just a prefix of a longer extension name
+        if ((p == extensions || p[-1] == ' ') && (p[len] == ' ' || p[len] == '\0'))
+            return true;
+    }
+    return false;
+}
+
+//Same version and profile as the GLFW window hints
+static const EGLint contextAttribs[] = {
+    EGL_CONTEXT_MAJOR_VERSION, 3,
+    EGL_CONTEXT_MINOR_VERSION, 3,
+    EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+    EGL_NONE
+};
+
+//Prefer Mesa's surfaceless platform, it needs no X server, no DRM node and no GPU
+static EGLDisplay get_display() {
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+    if (has_extension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+        if (getPlatformDisplay) {
+            EGLDisplay display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+            if (display != EGL_NO_DISPLAY)
+                return display;
+        }
+    }
+
+    return eglGetDisplay(EGL_DEFAULT_DISPLAY);
+}
+
+int create_headless_context(HeadlessContext& ctx, int width, int height) {
+    EGLDisplay display = get_display();
+    EGLint major, minor;
+
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &major, &minor)) {
+        std::cerr << "Failed to initialize EGL display" << std::endl;
+        return -1;
+    }
+
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        std::cerr << "EGL display does not support desktop OpenGL" << std::endl;
+        eglTerminate(display);
+        return -1;
+    }
+
+    //Rendering always goes into an FBO, so a pbuffer is only a fallback for drivers that can't go surfaceless
+    bool surfaceless = has_extension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE,    surfaceless ? 0 : EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE,   8,
+        EGL_GREEN_SIZE, 8,
+        EGL_BLUE_SIZE,  8,
+        EGL_ALPHA_SIZE, 8,
+        EGL_NONE
+    };
+
+    EGLConfig config;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || numConfigs < 1) {
+        std::cerr << "No suitable EGL config found" << std::endl;
+        eglTerminate(display);
+        return -1;
+    }
+
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    if (context == EGL_NO_CONTEXT) {
+        std::cerr << "Failed to create EGL OpenGL 3.3 core context" << std::endl;
+        eglTerminate(display);
+        return -1;
+    }
+
+    EGLSurface surface = EGL_NO_SURFACE;
+    if (!surfaceless) {
+        const EGLint pbufferAttribs[] = {
+            EGL_WIDTH,  width,
+            EGL_HEIGHT, height,
+            EGL_NONE
+        };
+        surface = eglCreatePbufferSurface(display, config, pbufferAttribs);
+        if (surface == EGL_NO_SURFACE) {
+            std::cerr << "Failed to create EGL pbuffer surface" << std::endl;
+            eglDestroyContext(display, context);
+            eglTerminate(display);
+            return -1;
+        }
+    }
+
+    if (!eglMakeCurrent(display, surface, surface, context)) {
+        std::cerr << "Failed to make EGL context current" << std::endl;
+        if (surface != EGL_NO_SURFACE)
+            eglDestroySurface(display, surface);
+        eglDestroyContext(display, context);
+        eglTerminate(display);
+        return -1;
+    }
+
+    ctx.display = display;
+    ctx.context = context;
+    ctx.surface = surface;
+    ctx.config = config;
+
+    if (!gladLoadGLLoader((GLADloadproc)eglGetProcAddress)) {
+        std::cerr << "Failed to initialize glad with processes " << std::endl;
+        destroy_headless_context(ctx);
+        return -1;
+    }
+
+    std::cerr << "Headless EGL " << major << "." << minor << ": "
+              << glGetString(GL_RENDERER) << (surfaceless ? " (surfaceless)" : " (pbuffer)") << std::endl;
+
+    return 0;
+}
+
+int create_shared_headless_context(const HeadlessContext& ctx, HeadlessContext& shared) {
+    EGLDisplay display = (EGLDisplay)ctx.display;
+
+    EGLContext context = eglCreateContext(display, (EGLConfig)ctx.config, (EGLContext)ctx.context, contextAttribs);
+    if (context == EGL_NO_CONTEXT) {
+        std::cerr << "Failed to create shared EGL context" << std::endl;
+        return -1;
+    }
+
+    //Only needs a surface of its own if the main context needed one
+    EGLSurface surface = EGL_NO_SURFACE;
+    if (ctx.surface) {
+        const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        surface = eglCreatePbufferSurface(display, (EGLConfig)ctx.config, pbufferAttribs);
+        if (surface == EGL_NO_SURFACE) {
+            std::cerr << "Failed to create shared EGL pbuffer surface" << std::endl;
+            eglDestroyContext(display, context);
+            return -1;
+        }
+    }
+
+    shared.display = display;
+    shared.context = context;
+    shared.surface = surface;
+    shared.config = ctx.config;
+    return 0;
+}
+
+bool make_headless_current(const HeadlessContext& ctx, bool current) {
+    EGLDisplay display = (EGLDisplay)ctx.display;
+
+    //The bound API is per thread and defaults to OpenGL ES
+    eglBindAPI(EGL_OPENGL_API);
+
+    if (!current)
+        return eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+    EGLSurface surface = ctx.surface ? (EGLSurface)ctx.surface : EGL_NO_SURFACE;
+    return eglMakeCurrent(display, surface, surface, (EGLContext)ctx.context);
+}
+
+void destroy_shared_headless_context(HeadlessContext& shared) {
+    if (!shared.display)
+        return;
+
+    EGLDisplay display = (EGLDisplay)shared.display;
+    if (shared.surface)
+        eglDestroySurface(display, (EGLSurface)shared.surface);
+    if (shared.context)
+        eglDestroyContext(display, (EGLContext)shared.context);
+
+    shared = HeadlessContext();
+}
+
+void destroy_headless_context(HeadlessContext& ctx) {
+    if (!ctx.display)
+        return;
+
+    EGLDisplay display = (EGLDisplay)ctx.display;
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+    if (ctx.surface)
+        eglDestroySurface(display, (EGLSurface)ctx.surface);
+    if (ctx.context)
+        eglDestroyContext(display, (EGLContext)ctx.context);
+    eglTerminate(display);
+
+    ctx = HeadlessContext();
+}
@@ -0,0 +1,25 @@
+#pragma once
+
+//Offscreen EGL context for machines without a display or GPU (e.g. Mesa llvmpipe).
+//The handles are kept opaque so the EGL headers stay out of the rest of the program
+struct HeadlessContext {
+    void* display = nullptr;
+    void* context = nullptr;
+    void* surface = nullptr; //Stays EGL_NO_SURFACE when the driver supports surfaceless contexts
+    void* config = nullptr;
+};
+
+//Create an OpenGL 3.3 core context with no window, make it current and load glad with it
+int create_headless_context(HeadlessContext& ctx, int width, int height);
+
+//Create a second context sharing objects with `ctx`, e.g. for a compile thread. Not made current
+int create_shared_headless_context(const HeadlessContext& ctx, HeadlessContext& shared);
+
+//Make a context current on the calling thread, or release the thread's context with `current == false`
+bool make_headless_current(const HeadlessContext& ctx, bool current);
+
+//Release the context and the EGL display
+void destroy_headless_context(HeadlessContext& ctx);
+
+//Release a context from create_shared_headless_context, the display stays up
+void destroy_shared_headless_context(HeadlessContext& shared);
@@ -0,0 +1,109 @@
+#include "hot_reload.h"
+#include "shader.h"
+
+#include <iostream>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/inotify.h>
+
+int init_shader_reloader(ShaderReloader& reloader, const std::vector<std::string>& paths, AsyncCompiler& compiler) {
+    reloader.inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (reloader.inotifyFd < 0) {
+        std::cerr << "Failed to start watching shaders: " << strerror(errno) << std::endl;
+        return -1;
+    }
+
+    reloader.compiler = &compiler;
+
+    for (const std::string& path : paths) {
+        std::unique_ptr<ShaderReload> reload(new ShaderReload());
+        reload->path = path;
+
+        if (!path.empty()) {
+            size_t slash = path.find_last_of('/');
+            std::string directory = slash == std::string::npos ? "." : path.substr(0, slash + 1);
+            reload->name = slash == std::string::npos ? path : path.substr(slash + 1);
+
+            //Saving in place closes a write, saving through a temporary file moves onto the name
+            reload->watch = inotify_add_watch(reloader.inotifyFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+            if (reload->watch < 0)
+                std::cerr << "Failed to watch " << path << ": " << strerror(errno) << std::endl;
+        }
+
+        reloader.shaders.push_back(std::move(reload));
+    }
+
+    std::cerr << "Watching shaders for changes ("
+              << (compiler.parallelCompile ? "parallel shader compile" : "compile thread") << ")" << std::endl;
+    return 0;
+}
+
+//Mark every shader named by the queued inotify events as changed
+static void read_events(ShaderReloader& reloader) {
+    alignas(inotify_event) char buffer[4096];
+
+    for (;;) {
+        ssize_t length = read(reloader.inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0)
+            break;
+
+        for (char* p = buffer; p < buffer + length; ) {
+            const inotify_event* event = reinterpret_cast<const inotify_event*>(p);
+
+            for (auto& reload : reloader.shaders) {
+                if (event->len && reload->watch == event->wd && reload->name == event->name)
+                    reload->changed = true;
+            }
+            p += sizeof(inotify_event) + event->len;
+        }
+    }
+}
+
+static void start_compile(ShaderReloader& reloader, ShaderReload& reload) {
+    if (read_file(reload.path.c_str(), reload.source))
+        return;
+
+    std::string source = reload.prelude.empty() ? reload.source : insert_after_version(reload.source, reload.prelude);
+    start_async_compile(*reloader.compiler, reload.compile, source);
+}
+
+int poll_shader_reloader(ShaderReloader& reloader, GLuint& program, std::string& source) {
+    read_events(reloader);
+
+    for (size_t i = 0; i < reloader.shaders.size(); i++) {
+        ShaderReload& reload = *reloader.shaders[i];
+        if (async_compile_pending(reload.compile)) {
+            bool done = false;
+            GLuint linked = finish_async_compile(reload.compile, done);
+            if (!done)
+                continue;
+
+            if (linked) {
+                std::cerr << "Reloaded " << reload.path << std::endl;
+                program = linked;
+                source = reload.source;
+                return static_cast<int>(i);
+            }
+            std::cerr << "Keeping the previous program for " << reload.path << std::endl;
+        }
+
+        //Edits made while compiling are picked up once the previous compile is done
+        if (reload.changed) {
+            reload.changed = false;
+            start_compile(reloader, reload);
+        }
+    }
+
+    return -1;
+}
+
+void destroy_shader_reloader(ShaderReloader& reloader) {
+    for (auto& reload : reloader.shaders)
+        cancel_async_compile(reload->compile);
+    reloader.shaders.clear();
+
+    if (reloader.inotifyFd >= 0)
+        close(reloader.inotifyFd);
+    reloader.inotifyFd = -1;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "async_compile.h"
+
+//One shader file being live-edited
+struct ShaderReload {
+    std::string path;
+    std::string name;    //File name inside the watched directory
+    std::string prelude; //Inserted after #version before compiling, like the initial program
+    int watch = -1;      //inotify watch of the directory, -1 when not watched
+    bool changed = false;
+
+    AsyncProgram compile;
+    std::string source; //File contents `compile` started from, before the prelude
+};
+
+//Watches shader files with inotify and recompiles them off the render path. The render loop
+//keeps using the old program until the new one has linked, then swaps it in between frames.
+//Editors that save through a rename are handled by watching the containing directories
+struct ShaderReloader {
+    int inotifyFd = -1;
+    AsyncCompiler* compiler = nullptr;
+
+    std::vector<std::unique_ptr<ShaderReload>> shaders;
+};
+
+//Watch `paths` (empty entries are skipped but keep their index), compiling with `compiler`
+int init_shader_reloader(ShaderReloader& reloader, const std::vector<std::string>& paths, AsyncCompiler& compiler);
+
+//Pick up edits and finished compiles without blocking. Returns the index of a path whose
+//new program linked and stores it in `program` and the file contents it was compiled from in
+//`source`, or -1 when nothing is ready
+int poll_shader_reloader(ShaderReloader& reloader, GLuint& program, std::string& source);
+
+void destroy_shader_reloader(ShaderReloader& reloader);
@@ -0,0 +1,498 @@
+#include "image_io.h"
+
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+
+//Largest image loaded, e.g. 16384x16384. Keeps every size derived from a header far from overflowing
+static const uint64_t MAX_PIXELS = 1ull << 28;
+
+static bool image_size_ok(int width, int height) {
+    return width > 0 && height > 0 && static_cast<uint64_t>(width) * height <= MAX_PIXELS;
+}
+
+//Bit reader over a zlib stream, least significant bit first as DEFLATE packs them
+struct InflateReader {
+    const unsigned char* data = nullptr;
+    size_t size = 0;
+    size_t pos = 0;
+    uint32_t cache = 0;
+    int cacheBits = 0;
+    bool overrun = false;
+};
+
+static uint32_t read_bits(InflateReader& in, int count) {
+    while (in.cacheBits < count) {
+        uint32_t byte = 0;
+        if (in.pos < in.size)
+            byte = in.data[in.pos++];
+        else
+            in.overrun = true;
+        in.cache |= byte << in.cacheBits;
+        in.cacheBits += 8;
+    }
+
+    uint32_t value = in.cache & ((1u << count) - 1);
+    in.cache >>= count;
+    in.cacheBits -= count;
+    return value;
+}
+
+//Canonical Huffman code: how many codes have each length, and the symbols in code order
+struct Huffman {
+    uint16_t counts[16];
+    uint16_t symbols[288];
+};
+
+static void build_huffman(Huffman& code, const uint8_t* lengths, int count) {
+    memset(code.counts, 0, sizeof(code.counts));
+    for (int i = 0; i < count; i++)
+        code.counts[lengths[i]]++;
+    code.counts[0] = 0;
+
+    uint16_t offsets[16] = {0};
+    for (int length = 1; length < 15; length++)
+        offsets[length + 1] = offsets[length] + code.counts[length];
+    for (int i = 0; i < count; i++) {
+        if (lengths[i])
+            code.symbols[offsets[lengths[i]]++] = static_cast<uint16_t>(i);
+    }
+}
+
+//Codes are read a bit at a time, first code of each length onwards
+static int decode_symbol(InflateReader& in, const Huffman& code) {
+    int value = 0, first = 0, index = 0;
+    for (int length = 1; length < 16; length++) {
+        value |= read_bits(in, 1);
+        int count = code.counts[length];
+        if (value - first < count)
+            return code.symbols[index + value - first];
+        index += count;
+        first = (first + count) << 1;
+        value <<= 1;
+    }
+    return -1;
+}
+
+static const uint16_t LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                         35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+static const uint8_t LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                         3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+static const uint16_t DISTANCE_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                           257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                           8193, 12289, 16385, 24577};
+static const uint8_t DISTANCE_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                           7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+static int inflate_block(InflateReader& in, const Huffman& literals, const Huffman& distances,
+                         size_t limit, std::vector<unsigned char>& out) {
+    for (;;) {
+        int symbol = decode_symbol(in, literals);
+        if (symbol < 0 || in.overrun)
+            return -1;
+        if (symbol < 256) {
+            if (out.size() == limit)
+                return -1;
+            out.push_back(static_cast<unsigned char>(symbol));
+            continue;
+        }
+        if (symbol == 256)
+            return 0;
+
+        symbol -= 257;
+        if (symbol >= 29)
+            return -1;
+        size_t length = LENGTH_BASE[symbol] + read_bits(in, LENGTH_EXTRA[symbol]);
+
+        int distanceSymbol = decode_symbol(in, distances);
+        if (distanceSymbol < 0 || distanceSymbol >= 30)
+            return -1;
+        size_t distance = DISTANCE_BASE[distanceSymbol] + read_bits(in, DISTANCE_EXTRA[distanceSymbol]);
+        if (distance > out.size() || length > limit - out.size())
+            return -1;
+
+        //Byte by byte, the copy may overlap what it writes
+        size_t from = out.size() - distance;
+        for (size_t i = 0; i < length; i++)
+            out.push_back(out[from + i]);
+    }
+}
+
+//Code lengths of a dynamic block, themselves Huffman coded
+static int read_dynamic_codes(InflateReader& in, Huffman& literals, Huffman& distances) {
+    static const uint8_t ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+    int literalCount = read_bits(in, 5) + 257;
+    int distanceCount = read_bits(in, 5) + 1;
+    int lengthCount = read_bits(in, 4) + 4;
+    if (literalCount > 286 || distanceCount > 30)
+        return -1;
+
+    uint8_t lengths[320] = {0};
+    for (int i = 0; i < lengthCount; i++)
+        lengths[ORDER[i]] = static_cast<uint8_t>(read_bits(in, 3));
+    Huffman lengthCode;
+    build_huffman(lengthCode, lengths, 19);
+
+    memset(lengths, 0, sizeof(lengths));
+    for (int i = 0; i < literalCount + distanceCount; ) {
+        int symbol = decode_symbol(in, lengthCode);
+        if (symbol < 0 || in.overrun)
+            return -1;
+
+        if (symbol < 16) {
+            lengths[i++] = static_cast<uint8_t>(symbol);
+            continue;
+        }
+
+        uint8_t repeated = 0;
+        int repeat;
+        if (symbol == 16) {
+            if (!i)
+                return -1;
+            repeated = lengths[i - 1];
+            repeat = 3 + read_bits(in, 2);
+        }
+        else if (symbol == 17) {
+            repeat = 3 + read_bits(in, 3);
+        }
+        else {
+            repeat = 11 + read_bits(in, 7);
+        }
+        if (i + repeat > literalCount + distanceCount)
+            return -1;
+        while (repeat--)
+            lengths[i++] = repeated;
+    }
+
+    build_huffman(literals, lengths, literalCount);
+    build_huffman(distances, lengths + literalCount, distanceCount);
+    return 0;
+}
+
+//Decompress a zlib stream (RFC 1950/1951), the Adler-32 checksum is not verified. Fails
+//rather than grow `out` past `limit` bytes
+static int inflate_zlib(const unsigned char* data, size_t size, size_t limit, std::vector<unsigned char>& out) {
+    if (size < 2 || (data[0] & 0x0f) != 8 || ((data[0] << 8) | data[1]) % 31 || (data[1] & 0x20))
+        return -1;
+
+    InflateReader in;
+    in.data = data + 2;
+    in.size = size - 2;
+
+    Huffman fixedLiterals, fixedDistances;
+    uint8_t lengths[288];
+    for (int i = 0; i < 288; i++)
+        lengths[i] = i < 144 ? 8 : i < 256 ? 9 : i < 280 ? 7 : 8;
+    build_huffman(fixedLiterals, lengths, 288);
+    memset(lengths, 5, 30);
+    build_huffman(fixedDistances, lengths, 30);
+
+    for (bool last = false; !last; ) {
+        last = read_bits(in, 1);
+        int type = read_bits(in, 2);
+
+        if (type == 0) {
+            //Stored: byte aligned, length and its complement, then the bytes
+            in.cache = 0;
+            in.cacheBits = 0;
+            if (in.pos + 4 > in.size)
+                return -1;
+            unsigned length = in.data[in.pos] | (in.data[in.pos + 1] << 8);
+            unsigned complement = in.data[in.pos + 2] | (in.data[in.pos + 3] << 8);
+            in.pos += 4;
+            if ((length ^ 0xffff) != complement || in.pos + length > in.size || length > limit - out.size())
+                return -1;
+            out.insert(out.end(), in.data + in.pos, in.data + in.pos + length);
+            in.pos += length;
+        }
+        else if (type == 1) {
+            if (inflate_block(in, fixedLiterals, fixedDistances, limit, out))
+                return -1;
+        }
+        else if (type == 2) {
+            Huffman literals, distances;
+            if (read_dynamic_codes(in, literals, distances) || inflate_block(in, literals, distances, limit, out))
+                return -1;
+        }
+        else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static uint32_t read_be32(const unsigned char* p) {
+    return (static_cast<uint32_t>(p[0]) << 24) | (p[1] << 16) | (p[2] << 8) | p[3];
+}
+
+static uint16_t float_to_half(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = (bits >> 16) & 0x8000;
+    int exponent = static_cast<int>((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    if (exponent >= 31)
+        return sign | 0x7c00;
+    if (exponent <= 0) {
+        //Subnormal, in units of 2^-24
+        return sign | static_cast<uint16_t>(std::lrint(std::fabs(value) * 16777216.0f));
+    }
+
+    //Round to nearest, a carry into the exponent is still the right value
+    return sign | static_cast<uint16_t>(((exponent << 10) | (mantissa >> 13)) + ((mantissa >> 12) & 1));
+}
+
+//Fill `image` from decoded RGBA samples of `depth` bits, 8 bit into RGBA8, 16 bit into RGBA16F
+static void store_rgba(Image& image, int depth, size_t pixel, const uint32_t rgba[4]) {
+    if (depth == 8) {
+        for (int c = 0; c < 4; c++)
+            image.pixels[pixel * 4 + c] = static_cast<unsigned char>(rgba[c]);
+    }
+    else {
+        for (int c = 0; c < 4; c++) {
+            uint16_t half = float_to_half(rgba[c] / 65535.0f);
+            memcpy(&image.pixels[(pixel * 4 + c) * 2], &half, sizeof(half));
+        }
+    }
+}
+
+static int load_png(const std::string& path, const std::vector<unsigned char>& file, Image& image) {
+    const unsigned char* p = file.data() + 8;
+    const unsigned char* end = file.data() + file.size();
+
+    int depth = 0, colourType = -1;
+    std::vector<unsigned char> compressed;
+    unsigned char palette[256][4];
+    for (int i = 0; i < 256; i++)
+        palette[i][0] = palette[i][1] = palette[i][2] = 0, palette[i][3] = 255;
+
+    //Chunks: length, type, data, CRC (not verified)
+    while (p + 12 <= end) {
+        uint32_t length = read_be32(p);
+        const unsigned char* data = p + 8;
+        if (length > static_cast<size_t>(end - data) - 4)
+            break;
+
+        if (!memcmp(p + 4, "IHDR", 4) && length >= 13) {
+            image.width = read_be32(data);
+            image.height = read_be32(data + 4);
+            depth = data[8];
+            colourType = data[9];
+            if (data[12]) {
+                std::cerr << path << ": interlaced PNGs aren't supported" << std::endl;
+                return -1;
+            }
+        }
+        else if (!memcmp(p + 4, "PLTE", 4)) {
+            for (uint32_t i = 0; i < length / 3 && i < 256; i++)
+                memcpy(palette[i], data + i * 3, 3);
+        }
+        else if (!memcmp(p + 4, "tRNS", 4) && colourType == 3) {
+            for (uint32_t i = 0; i < length && i < 256; i++)
+                palette[i][3] = data[i];
+        }
+        else if (!memcmp(p + 4, "IDAT", 4)) {
+            compressed.insert(compressed.end(), data, data + length);
+        }
+        else if (!memcmp(p + 4, "IEND", 4)) {
+            break;
+        }
+        p = data + length + 4;
+    }
+
+    static const int CHANNELS[7] = {1, 0, 3, 1, 2, 0, 4};
+    bool supported = colourType >= 0 && colourType <= 6 && CHANNELS[colourType]
+                     && (depth == 8 || (depth == 16 && colourType != 3));
+    if (!supported) {
+        std::cerr << path << ": only 8 and 16 bit PNGs (palettes at 8 bit) are supported" << std::endl;
+        return -1;
+    }
+    if (!image_size_ok(image.width, image.height)) {
+        std::cerr << path << ": image size " << image.width << "x" << image.height << " is out of range" << std::endl;
+        return -1;
+    }
+
+    int channels = CHANNELS[colourType];
+    size_t bytesPerPixel = channels * depth / 8;
+    size_t rowBytes = image.width * bytesPerPixel;
+
+    //Deflate expands at most 1032 fold, so a header claiming more than that is corrupt. Checked
+    //before anything the size of the image is allocated
+    size_t rawBytes = (rowBytes + 1) * image.height;
+    if (rawBytes / 1032 > compressed.size()) {
+        std::cerr << path << ": corrupt image data" << std::endl;
+        return -1;
+    }
+
+    std::vector<unsigned char> raw;
+    raw.reserve(rawBytes);
+    if (inflate_zlib(compressed.data(), compressed.size(), rawBytes, raw) || raw.size() < rawBytes) {
+        std::cerr << path << ": corrupt image data" << std::endl;
+        return -1;
+    }
+
+    //Undo the per-row filters in place, each row starts with its filter type
+    for (int y = 0; y < image.height; y++) {
+        unsigned char* row = raw.data() + y * (rowBytes + 1) + 1;
+        const unsigned char* previous = y ? row - (rowBytes + 1) : nullptr;
+        int filter = row[-1];
+
+        for (size_t i = 0; i < rowBytes; i++) {
+            int left = i >= bytesPerPixel ? row[i - bytesPerPixel] : 0;
+            int up = previous ? previous[i] : 0;
+            int upLeft = previous && i >= bytesPerPixel ? previous[i - bytesPerPixel] : 0;
+
+            int predicted = 0;
+            if (filter == 1) {
+                predicted = left;
+            }
+            else if (filter == 2) {
+                predicted = up;
+            }
+            else if (filter == 3) {
+                predicted = (left + up) / 2;
+            }
+            else if (filter == 4) {
+                int estimate = left + up - upLeft;
+                int dl = std::abs(estimate - left), du = std::abs(estimate - up), dul = std::abs(estimate - upLeft);
+                predicted = dl <= du && dl <= dul ? left : du <= dul ? up : upLeft;
+            }
+            else if (filter != 0) {
+                std::cerr << path << ": corrupt row filter" << std::endl;
+                return -1;
+            }
+            row[i] = static_cast<unsigned char>(row[i] + predicted);
+        }
+    }
+
+    image.format = depth == 8 ? PIXEL_RGBA8 : PIXEL_RGBA16F;
+    image.pixels.resize(static_cast<size_t>(image.width) * image.height * (depth == 8 ? 4 : 8));
+    uint32_t maximum = depth == 8 ? 255 : 65535;
+
+    for (int y = 0; y < image.height; y++) {
+        const unsigned char* row = raw.data() + y * (rowBytes + 1) + 1;
+        for (int x = 0; x < image.width; x++) {
+            uint32_t samples[4] = {0, 0, 0, maximum};
+            for (int c = 0; c < channels; c++) {
+                const unsigned char* sample = row + (x * channels + c) * (depth / 8);
+                samples[c] = depth == 8 ? sample[0] : (sample[0] << 8) | sample[1];
+            }
+
+            uint32_t rgba[4];
+            if (colourType == 3) {
+                for (int c = 0; c < 4; c++)
+                    rgba[c] = palette[samples[0]][c];
+            }
+            else if (channels <= 2) {
+                //Grey, optionally with alpha
+                rgba[0] = rgba[1] = rgba[2] = samples[0];
+                rgba[3] = channels == 2 ? samples[1] : maximum;
+            }
+            else {
+                for (int c = 0; c < 4; c++)
+                    rgba[c] = samples[c];
+            }
+            store_rgba(image, depth, static_cast<size_t>(y) * image.width + x, rgba);
+        }
+    }
+    return 0;
+}
+
+//Next whitespace separated header field of a PPM, skipping comments
+static int ppm_field(const std::vector<unsigned char>& file, size_t& pos) {
+    for (;;) {
+        while (pos < file.size() && isspace(file[pos]))
+            pos++;
+        if (pos < file.size() && file[pos] == '#') {
+            while (pos < file.size() && file[pos] != '\n')
+                pos++;
+            continue;
+        }
+        break;
+    }
+
+    int value = 0;
+    bool digits = false;
+    for (; pos < file.size() && isdigit(file[pos]); pos++, digits = true) {
+        if (value > (INT_MAX - 9) / 10)
+            return -1;
+        value = value * 10 + (file[pos] - '0');
+    }
+    return digits ? value : -1;
+}
+
+static int load_ppm(const std::string& path, const std::vector<unsigned char>& file, Image& image) {
+    size_t pos = 2;
+    image.width = ppm_field(file, pos);
+    image.height = ppm_field(file, pos);
+    int maximum = ppm_field(file, pos);
+    pos++;
+
+    if (image.width <= 0 || image.height <= 0 || maximum <= 0 || maximum > 65535) {
+        std::cerr << path << ": not a complete binary PPM" << std::endl;
+        return -1;
+    }
+    if (!image_size_ok(image.width, image.height)) {
+        std::cerr << path << ": image size " << image.width << "x" << image.height << " is out of range" << std::endl;
+        return -1;
+    }
+
+    int depth = maximum > 255 ? 16 : 8;
+    size_t bytes = static_cast<size_t>(image.width) * image.height * 3 * (depth / 8);
+    if (file.size() < pos + bytes) {
+        std::cerr << path << ": not a complete binary PPM" << std::endl;
+        return -1;
+    }
+
+    image.format = depth == 8 ? PIXEL_RGBA8 : PIXEL_RGBA16F;
+    image.pixels.resize(static_cast<size_t>(image.width) * image.height * (depth == 8 ? 4 : 8));
+    const unsigned char* sample = file.data() + pos;
+    for (size_t pixel = 0; pixel < static_cast<size_t>(image.width) * image.height; pixel++) {
+        uint32_t rgba[4] = {0, 0, 0, depth == 8 ? 255u : 65535u};
+        for (int c = 0; c < 3; c++) {
+            uint32_t value = depth == 8 ? *sample++ : (sample[0] << 8) | sample[1];
+            if (depth == 16)
+                sample += 2;
+            //Rescale odd maxima to the full range
+            rgba[c] = (value * (depth == 8 ? 255u : 65535u) + maximum / 2) / maximum;
+        }
+        store_rgba(image, depth, pixel, rgba);
+    }
+    return 0;
+}
+
+int load_image(const std::string& path, Image& image) {
+    std::ifstream stream(path, std::ios::binary);
+    if (!stream) {
+        std::cerr << "Failed to open " << path << std::endl;
+        return -1;
+    }
+    std::vector<unsigned char> file((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+
+    static const unsigned char PNG_SIGNATURE[8] = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    if (file.size() > 8 && !memcmp(file.data(), PNG_SIGNATURE, 8))
+        return load_png(path, file, image);
+    if (file.size() > 2 && file[0] == 'P' && file[1] == '6')
+        return load_ppm(path, file, image);
+
+    std::cerr << path << ": not a PNG or binary PPM" << std::endl;
+    return -1;
+}
+
+ImageView image_view(const Image& image) {
+    ImageView view;
+    view.pixels = image.pixels.data();
+    view.width = image.width;
+    view.height = image.height;
+    view.format = image.format;
+    return view;
+}
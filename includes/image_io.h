@@ -0,0 +1,20 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "metrics.h"
+
+//A decoded image, rows top-down
+struct Image {
+    int width = 0;
+    int height = 0;
+    PixelFormat format = PIXEL_RGBA8;
+    std::vector<unsigned char> pixels;
+};
+
+//Load a PNG (non-interlaced, any colour type, 8 bit or 16 bit, palettes at 8 bit) or a binary PPM,
+//told apart by their signatures. 16 bit images load as RGBA16F, the rest as RGBA8
+int load_image(const std::string& path, Image& image);
+
+ImageView image_view(const Image& image);
@@ -0,0 +1,201 @@
+#include "interleave.h"
+#include "shader.h"
+
+#include <iostream>
+
+//Partial texel (x, y) stands for pixel (x * scale.x + offset, y * scale.y + phase.y), where the
+//checkerboard staggers the offset every row. No functions, it may be used in global initializers
+const char* interleavePrelude =
+R"(uniform vec2 shadedInterleaveScale;
+uniform vec2 shadedInterleavePhase;
+uniform float shadedInterleaveStagger;
+#define gl_FragCoord vec4(floor(gl_FragCoord.xy) * shadedInterleaveScale + vec2(mod(shadedInterleavePhase.x + shadedInterleaveStagger * floor(gl_FragCoord.y), 2.0), shadedInterleavePhase.y) + 0.5, gl_FragCoord.zw))";
+
+static const char* resolveFragmentSource =
+R"(#version 330 core
+uniform sampler2D current;
+uniform sampler2D history;
+uniform ivec2 phase;
+uniform ivec2 scale;
+uniform int stagger;
+uniform bool hasHistory;
+out vec4 fragColor;
+
+int offsetX(int y) {
+    return (phase.x + stagger * y) & 1;
+}
+
+//Sample of a pixel shaded this frame
+vec4 fresh(ivec2 p) {
+    ivec2 t = ivec2((p.x - offsetX(p.y)) / 2, (p.y - phase.y) / scale.y);
+    return texelFetch(current, min(t, textureSize(current, 0) - 1), 0);
+}
+
+//Neighbour `d` away, mirrored at the frame edges where the pattern repeats the same way
+vec4 neighbour(ivec2 p, ivec2 d) {
+    ivec2 q = p + d;
+    if (any(lessThan(q, ivec2(0))) || any(greaterThanEqual(q, textureSize(history, 0))))
+        q = p - d;
+    return fresh(q);
+}
+
+void main() {
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    bool freshX = ((p.x - offsetX(p.y)) & 1) == 0;
+    bool freshY = scale.y == 1 || ((p.y - phase.y) & 1) == 0;
+    if (freshX && freshY) {
+        fragColor = fresh(p);
+        return;
+    }
+
+    //Checkerboard: all 4 direct neighbours are fresh. 2x2: the 2 or 4 nearest pixels of the grid
+    vec4 taps[4];
+    int count = 0;
+    if (scale.y == 1) {
+        taps[0] = neighbour(p, ivec2(-1, 0));
+        taps[1] = neighbour(p, ivec2(1, 0));
+        taps[2] = neighbour(p, ivec2(0, -1));
+        taps[3] = neighbour(p, ivec2(0, 1));
+        count = 4;
+    }
+    else {
+        for (int y = freshY ? 0 : -1; y <= (freshY ? 0 : 1); y += 2)
+            for (int x = freshX ? 0 : -1; x <= (freshX ? 0 : 1); x += 2)
+                taps[count++] = neighbour(p, ivec2(x, y));
+    }
+
+    vec4 lo = taps[0], hi = taps[0], sum = taps[0];
+    for (int i = 1; i < count; i++) {
+        lo = min(lo, taps[i]);
+        hi = max(hi, taps[i]);
+        sum += taps[i];
+    }
+
+    //Older samples are kept as long as they fit what the fresh ones around them show
+    fragColor = hasHistory ? clamp(texelFetch(history, p, 0), lo, hi) : sum / float(count);
+})";
+
+//Order the 2x2 grid is visited in, diagonal first so consecutive frames are far apart
+static const int GRID_PHASES[4][2] = {{0, 0}, {1, 1}, {1, 0}, {0, 1}};
+
+static bool allocate_texture(GLuint framebuffer, GLuint texture, int width, int height) {
+    glBindTexture(GL_TEXTURE_2D, texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texture, 0);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    return complete;
+}
+
+static bool allocate_targets(Interleave& il, int width, int height) {
+    il.width = width;
+    il.height = height;
+    il.partialWidth = (width + il.scaleX - 1) / il.scaleX;
+    il.partialHeight = (height + il.scaleY - 1) / il.scaleY;
+    il.hasHistory = false;
+
+    return allocate_texture(il.partialFramebuffer, il.partialTexture, il.partialWidth, il.partialHeight)
+           && allocate_texture(il.historyFramebuffers[0], il.historyTextures[0], width, height)
+           && allocate_texture(il.historyFramebuffers[1], il.historyTextures[1], width, height);
+}
+
+int init_interleave(Interleave& il, int factor, int width, int height) {
+    if (factor != 2 && factor != 4) {
+        std::cerr << "Interleaved rendering shades 1 of every 2 or 4 pixels" << std::endl;
+        return -1;
+    }
+
+    il.factor = factor;
+    il.scaleX = 2;
+    il.scaleY = factor == 4 ? 2 : 1;
+
+    il.program = create_program(resolveFragmentSource);
+    if (!il.program)
+        return -1;
+
+    glUseProgram(il.program);
+    glUniform1i(glGetUniformLocation(il.program, "current"), 0);
+    glUniform1i(glGetUniformLocation(il.program, "history"), 1);
+    glUniform2i(glGetUniformLocation(il.program, "scale"), il.scaleX, il.scaleY);
+    glUniform1i(glGetUniformLocation(il.program, "stagger"), factor == 2);
+    il.phaseLocation = glGetUniformLocation(il.program, "phase");
+    il.hasHistoryLocation = glGetUniformLocation(il.program, "hasHistory");
+
+    glGenFramebuffers(1, &il.partialFramebuffer);
+    glGenTextures(1, &il.partialTexture);
+    glGenFramebuffers(2, il.historyFramebuffers);
+    glGenTextures(2, il.historyTextures);
+    if (!allocate_targets(il, width, height)) {
+        std::cerr << "Interleave framebuffers are not complete" << std::endl;
+        destroy_interleave(il);
+        return -1;
+    }
+    return 0;
+}
+
+void begin_interleave(Interleave& il, GLuint program, int width, int height) {
+    if (width != il.width || height != il.height)
+        allocate_targets(il, width, height);
+
+    if (il.factor == 4) {
+        il.phaseX = GRID_PHASES[il.frame % 4][0];
+        il.phaseY = GRID_PHASES[il.frame % 4][1];
+    }
+    else {
+        il.phaseX = static_cast<int>(il.frame % 2);
+        il.phaseY = 0;
+    }
+    il.frame++;
+
+    //Looked up every frame, the program may have been hot reloaded
+    glUniform2f(glGetUniformLocation(program, "shadedInterleaveScale"), static_cast<float>(il.scaleX), static_cast<float>(il.scaleY));
+    glUniform2f(glGetUniformLocation(program, "shadedInterleavePhase"), static_cast<float>(il.phaseX), static_cast<float>(il.phaseY));
+    glUniform1f(glGetUniformLocation(program, "shadedInterleaveStagger"), il.factor == 2 ? 1.0f : 0.0f);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, il.partialFramebuffer);
+    glViewport(0, 0, il.partialWidth, il.partialHeight);
+}
+
+void end_interleave(Interleave& il, GLuint framebuffer, GLuint VAO) {
+    int write = il.current ^ 1;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, il.historyFramebuffers[write]);
+    glViewport(0, 0, il.width, il.height);
+    glUseProgram(il.program);
+    glUniform2i(il.phaseLocation, il.phaseX, il.phaseY);
+    glUniform1i(il.hasHistoryLocation, il.hasHistory);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, il.partialTexture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, il.historyTextures[il.current]);
+    glActiveTexture(GL_TEXTURE0);
+    glBindVertexArray(VAO);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, il.historyFramebuffers[write]);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebuffer);
+    glBlitFramebuffer(0, 0, il.width, il.height, 0, 0, il.width, il.height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+
+    il.current = write;
+    il.hasHistory = true;
+}
+
+void destroy_interleave(Interleave& il) {
+    if (il.program)
+        glDeleteProgram(il.program);
+    if (il.partialFramebuffer)
+        glDeleteFramebuffers(1, &il.partialFramebuffer);
+    if (il.partialTexture)
+        glDeleteTextures(1, &il.partialTexture);
+    if (il.historyFramebuffers[0])
+        glDeleteFramebuffers(2, il.historyFramebuffers);
+    if (il.historyTextures[0])
+        glDeleteTextures(2, il.historyTextures);
+
+    il = Interleave();
+}
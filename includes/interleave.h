@@ -0,0 +1,52 @@
+#pragma once
+
+#include <glad/glad.h>
+
+//Inserted into the image shader (see insert_after_version): declares the pattern uniforms and
+//redefines gl_FragCoord as the full resolution pixel each partial target texel stands for
+extern const char* interleavePrelude;
+
+//Interleaved rendering of the image pass: each frame shades 1 of every `factor` pixels into a
+//reduced-size target, 2 in a checkerboard (alternate columns, staggered per row) or 4 in a 2x2
+//grid, moving to the next pixels of the pattern every frame. A resolve pass rebuilds the full
+//frame from the fresh samples and the previous output kept in a history target. Stale history
+//is clamped to the range of the neighbouring fresh samples, so moving content doesn't smear.
+//Costs 1/factor of the shading, for shaders that change smoothly from frame to frame
+struct Interleave {
+    int factor = 0;
+    int scaleX = 1; //Full resolution pixels per partial texel
+    int scaleY = 1;
+    int phaseX = 0; //Pattern offset of this frame
+    int phaseY = 0;
+    unsigned long frame = 0;
+
+    GLuint partialFramebuffer = 0;
+    GLuint partialTexture = 0;
+    int partialWidth = 0;
+    int partialHeight = 0;
+
+    //Ping-pong pair of full resolution reconstructions, the one not written this frame is the history
+    GLuint historyFramebuffers[2] = {0, 0};
+    GLuint historyTextures[2] = {0, 0};
+    int current = 0;
+    bool hasHistory = false;
+    int width = 0;
+    int height = 0;
+
+    GLuint program = 0;
+    GLint phaseLocation = -1;
+    GLint hasHistoryLocation = -1;
+};
+
+//`factor` 2 (checkerboard) or 4 (2x2)
+int init_interleave(Interleave& il, int factor, int width, int height);
+
+//Advance the pattern and bind the partial target. Call with the image program in use,
+//it gets this frame's pattern through the prelude's uniforms. Restarts the history on resize
+void begin_interleave(Interleave& il, GLuint program, int width, int height);
+
+//Resolve into the next history target and copy it to `framebuffer` with the quad in `VAO`.
+//Leaves the resolve program bound, texture units 0 and 1 changed and the viewport at full size
+void end_interleave(Interleave& il, GLuint framebuffer, GLuint VAO);
+
+void destroy_interleave(Interleave& il);
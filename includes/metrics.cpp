@@ -0,0 +1,525 @@
+#include "metrics.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#if defined(__AVX2__) || defined(__F16C__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+//Rows per tile, a multiple of the SSIM stride
+static const int TILE_ROWS = 64;
+
+static const int SSIM_WINDOW = 8;
+static const int SSIM_STRIDE = 4;
+
+//SSIM stabilising constants for values in [0, 1], 0.01^2 and 0.03^2
+static const float SSIM_C1 = 0.0001f;
+static const float SSIM_C2 = 0.0009f;
+
+//Rec. 709 luma
+static const float LUMA_R = 0.2126f;
+static const float LUMA_G = 0.7152f;
+static const float LUMA_B = 0.0722f;
+
+//Lane types the kernels are written against, as in fft.cpp. Each kernel runs the vector lane
+//over as much of a row as fits and ScalarLane over the rest
+struct ScalarLane {
+    typedef float Type;
+    static const int WIDTH = 1;
+    static Type load(const float* p) { return *p; }
+    static void store(float* p, Type v) { *p = v; }
+    static Type set(float x) { return x; }
+    static Type add(Type a, Type b) { return a + b; }
+    static Type sub(Type a, Type b) { return a - b; }
+    static Type mul(Type a, Type b) { return a * b; }
+    static Type div(Type a, Type b) { return a / b; }
+    static Type min(Type a, Type b) { return a < b ? a : b; }
+    static Type max(Type a, Type b) { return a > b ? a : b; }
+    static Type abs(Type a) { return std::fabs(a); }
+    static Type sqrt(Type a) { return std::sqrt(a); }
+    static float sum(Type a) { return a; }
+    static float peak(Type a) { return a; }
+};
+
+#if defined(__AVX2__)
+struct VectorLane {
+    typedef __m256 Type;
+    static const int WIDTH = 8;
+    static Type load(const float* p) { return _mm256_loadu_ps(p); }
+    static void store(float* p, Type v) { _mm256_storeu_ps(p, v); }
+    static Type set(float x) { return _mm256_set1_ps(x); }
+    static Type add(Type a, Type b) { return _mm256_add_ps(a, b); }
+    static Type sub(Type a, Type b) { return _mm256_sub_ps(a, b); }
+    static Type mul(Type a, Type b) { return _mm256_mul_ps(a, b); }
+    static Type div(Type a, Type b) { return _mm256_div_ps(a, b); }
+    static Type min(Type a, Type b) { return _mm256_min_ps(a, b); }
+    static Type max(Type a, Type b) { return _mm256_max_ps(a, b); }
+    static Type abs(Type a) { return _mm256_andnot_ps(_mm256_set1_ps(-0.0f), a); }
+    static Type sqrt(Type a) { return _mm256_sqrt_ps(a); }
+    static float sum(Type a) {
+        __m128 s = _mm_add_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+        s = _mm_add_ps(s, _mm_movehl_ps(s, s));
+        return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+    }
+    static float peak(Type a) {
+        __m128 s = _mm_max_ps(_mm256_castps256_ps128(a), _mm256_extractf128_ps(a, 1));
+        s = _mm_max_ps(s, _mm_movehl_ps(s, s));
+        return _mm_cvtss_f32(_mm_max_ss(s, _mm_shuffle_ps(s, s, 1)));
+    }
+};
+static const char* kernels = "avx2";
+#elif defined(__SSE2__)
+struct VectorLane {
+    typedef __m128 Type;
+    static const int WIDTH = 4;
+    static Type load(const float* p) { return _mm_loadu_ps(p); }
+    static void store(float* p, Type v) { _mm_storeu_ps(p, v); }
+    static Type set(float x) { return _mm_set1_ps(x); }
+    static Type add(Type a, Type b) { return _mm_add_ps(a, b); }
+    static Type sub(Type a, Type b) { return _mm_sub_ps(a, b); }
+    static Type mul(Type a, Type b) { return _mm_mul_ps(a, b); }
+    static Type div(Type a, Type b) { return _mm_div_ps(a, b); }
+    static Type min(Type a, Type b) { return _mm_min_ps(a, b); }
+    static Type max(Type a, Type b) { return _mm_max_ps(a, b); }
+    static Type abs(Type a) { return _mm_andnot_ps(_mm_set1_ps(-0.0f), a); }
+    static Type sqrt(Type a) { return _mm_sqrt_ps(a); }
+    static float sum(Type a) {
+        __m128 s = _mm_add_ps(a, _mm_movehl_ps(a, a));
+        return _mm_cvtss_f32(_mm_add_ss(s, _mm_shuffle_ps(s, s, 1)));
+    }
+    static float peak(Type a) {
+        __m128 s = _mm_max_ps(a, _mm_movehl_ps(a, a));
+        return _mm_cvtss_f32(_mm_max_ss(s, _mm_shuffle_ps(s, s, 1)));
+    }
+};
+static const char* kernels = "sse2";
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+struct VectorLane {
+    typedef float32x4_t Type;
+    static const int WIDTH = 4;
+    static Type load(const float* p) { return vld1q_f32(p); }
+    static void store(float* p, Type v) { vst1q_f32(p, v); }
+    static Type set(float x) { return vdupq_n_f32(x); }
+    static Type add(Type a, Type b) { return vaddq_f32(a, b); }
+    static Type sub(Type a, Type b) { return vsubq_f32(a, b); }
+    static Type mul(Type a, Type b) { return vmulq_f32(a, b); }
+    static Type div(Type a, Type b) { return vdivq_f32(a, b); }
+    static Type min(Type a, Type b) { return vminq_f32(a, b); }
+    static Type max(Type a, Type b) { return vmaxq_f32(a, b); }
+    static Type abs(Type a) { return vabsq_f32(a); }
+    static Type sqrt(Type a) { return vsqrtq_f32(a); }
+    static float sum(Type a) { return vaddvq_f32(a); }
+    static float peak(Type a) { return vmaxvq_f32(a); }
+};
+static const char* kernels = "neon";
+#else
+typedef ScalarLane VectorLane;
+static const char* kernels = "scalar";
+#endif
+
+const char* metrics_kernels() {
+    return kernels;
+}
+
+static float half_to_float(uint16_t half) {
+    uint32_t sign = static_cast<uint32_t>(half & 0x8000) << 16;
+    uint32_t exponent = (half >> 10) & 0x1f;
+    uint32_t mantissa = half & 0x3ff;
+
+    uint32_t bits;
+    if (exponent == 0x1f) {
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    }
+    else if (exponent) {
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    }
+    else {
+        //Zero or subnormal, exact in single precision
+        float value = std::ldexp(static_cast<float>(mantissa), -24);
+        return sign ? -value : value;
+    }
+
+    float value;
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+//`count` channel values of a row as floats, 8 bit ones scaled to [0, 1]
+static void row_to_float(const unsigned char* row, PixelFormat format, float* out, int count) {
+    int i = 0;
+    if (format == PIXEL_RGBA8) {
+        const float scale = 1.0f / 255.0f;
+#if defined(__AVX2__)
+        for (; i + 8 <= count; i += 8) {
+            __m256i words = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(row + i)));
+            _mm256_storeu_ps(out + i, _mm256_mul_ps(_mm256_cvtepi32_ps(words), _mm256_set1_ps(scale)));
+        }
+#elif defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        for (; i + 4 <= count; i += 4) {
+            int32_t packed;
+            memcpy(&packed, row + i, sizeof(packed));
+            __m128i words = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero), zero);
+            _mm_storeu_ps(out + i, _mm_mul_ps(_mm_cvtepi32_ps(words), _mm_set1_ps(scale)));
+        }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        for (; i + 8 <= count; i += 8) {
+            uint16x8_t words = vmovl_u8(vld1_u8(row + i));
+            vst1q_f32(out + i, vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_low_u16(words))), scale));
+            vst1q_f32(out + i + 4, vmulq_n_f32(vcvtq_f32_u32(vmovl_u16(vget_high_u16(words))), scale));
+        }
+#endif
+        for (; i < count; i++)
+            out[i] = row[i] * scale;
+    }
+    else {
+#if defined(__F16C__)
+        for (; i + 8 <= count; i += 8)
+            _mm256_storeu_ps(out + i, _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(row + i * 2))));
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+        for (; i + 4 <= count; i += 4)
+            vst1q_f32(out + i, vcvt_f32_f16(vreinterpret_f16_u16(vld1_u16(reinterpret_cast<const uint16_t*>(row + i * 2)))));
+#endif
+        for (; i < count; i++) {
+            uint16_t half;
+            memcpy(&half, row + i * 2, sizeof(half));
+            out[i] = half_to_float(half);
+        }
+    }
+}
+
+static inline float displayed(float value) {
+    //NaN becomes 0 too
+    return value > 0.0f ? (value < 1.0f ? value : 1.0f) : 0.0f;
+}
+
+static const unsigned char* row_pointer(const ImageView& image, int y) {
+    ptrdiff_t stride = image.stride ? image.stride
+                                    : static_cast<ptrdiff_t>(image.width) * (image.format == PIXEL_RGBA8 ? 4 : 8);
+    return static_cast<const unsigned char*>(image.pixels) + y * stride;
+}
+
+//Sum of squared differences of a row of one channel
+template <typename L>
+static float squared_error(const float* a, const float* b, int& x, int width) {
+    typedef typename L::Type V;
+    V total = L::set(0.0f);
+    for (; x + L::WIDTH <= width; x += L::WIDTH) {
+        V d = L::sub(L::load(a + x), L::load(b + x));
+        total = L::add(total, L::mul(d, d));
+    }
+    return L::sum(total);
+}
+
+//Sums of a, b, a^2, b^2 and ab down the 4 rows of an SSIM block, per column
+template <typename L>
+static void block_columns(const float* const a[SSIM_STRIDE], const float* const b[SSIM_STRIDE],
+                          float* const out[5], int& x, int width) {
+    typedef typename L::Type V;
+    for (; x + L::WIDTH <= width; x += L::WIDTH) {
+        V sa = L::set(0.0f), sb = sa, saa = sa, sbb = sa, sab = sa;
+        for (int r = 0; r < SSIM_STRIDE; r++) {
+            V va = L::load(a[r] + x), vb = L::load(b[r] + x);
+            sa = L::add(sa, va);
+            sb = L::add(sb, vb);
+            saa = L::add(saa, L::mul(va, va));
+            sbb = L::add(sbb, L::mul(vb, vb));
+            sab = L::add(sab, L::mul(va, vb));
+        }
+        L::store(out[0] + x, sa);
+        L::store(out[1] + x, sb);
+        L::store(out[2] + x, saa);
+        L::store(out[3] + x, sbb);
+        L::store(out[4] + x, sab);
+    }
+}
+
+//SSIM of a row of windows, each made of 2x2 blocks from the block rows `top` and `bottom`
+template <typename L>
+static float window_ssim(const float* const top[5], const float* const bottom[5], int& j, int windows) {
+    typedef typename L::Type V;
+    const V n = L::set(1.0f / (SSIM_WINDOW * SSIM_WINDOW));
+    const V two = L::set(2.0f), c1 = L::set(SSIM_C1), c2 = L::set(SSIM_C2);
+
+    V total = L::set(0.0f);
+    for (; j + L::WIDTH <= windows; j += L::WIDTH) {
+        V s[5];
+        for (int q = 0; q < 5; q++) {
+            s[q] = L::add(L::add(L::load(top[q] + j), L::load(top[q] + j + 1)),
+                          L::add(L::load(bottom[q] + j), L::load(bottom[q] + j + 1)));
+        }
+        V ma = L::mul(s[0], n), mb = L::mul(s[1], n);
+        V va = L::sub(L::mul(s[2], n), L::mul(ma, ma));
+        V vb = L::sub(L::mul(s[3], n), L::mul(mb, mb));
+        V cov = L::sub(L::mul(s[4], n), L::mul(ma, mb));
+
+        V numerator = L::mul(L::add(L::mul(two, L::mul(ma, mb)), c1), L::add(L::mul(two, cov), c2));
+        V denominator = L::mul(L::add(L::add(L::mul(ma, ma), L::mul(mb, mb)), c1), L::add(L::add(va, vb), c2));
+        total = L::add(total, L::div(numerator, denominator));
+    }
+    return L::sum(total);
+}
+
+//Row pointers of both frames for the perceptual difference. Luma rows are padded by a
+//replicated pixel on each side, `up` and `down` are the neighbouring rows (clamped at the edges)
+struct FlipRow {
+    const float* r[2];
+    const float* g[2];
+    const float* b[2];
+    const float* luma[2];
+    const float* up[2];
+    const float* down[2];
+};
+
+template <typename L>
+static void flip_row(const FlipRow& row, int& x, int width, float& sum, float& peak) {
+    typedef typename L::Type V;
+    const V half = L::set(0.5f), quarter = L::set(0.25f), one = L::set(1.0f);
+
+    V total = L::set(0.0f), worst = total;
+    for (; x + L::WIDTH <= width; x += L::WIDTH) {
+        V y[2], cx[2], cz[2], gradient[2];
+        for (int i = 0; i < 2; i++) {
+            V r = L::load(row.r[i] + x), g = L::load(row.g[i] + x), b = L::load(row.b[i] + x);
+            y[i] = L::load(row.luma[i] + x);
+            cx[i] = L::mul(half, L::sub(r, g));
+            cz[i] = L::sub(L::mul(quarter, L::add(r, g)), L::mul(half, b));
+
+            V dx = L::mul(half, L::sub(L::load(row.luma[i] + x + 1), L::load(row.luma[i] + x - 1)));
+            V dy = L::mul(half, L::sub(L::load(row.down[i] + x), L::load(row.up[i] + x)));
+            gradient[i] = L::sqrt(L::add(L::mul(dx, dx), L::mul(dy, dy)));
+        }
+
+        V dcx = L::sub(cx[0], cx[1]), dcz = L::sub(cz[0], cz[1]);
+        V colour = L::min(one, L::add(L::abs(L::sub(y[0], y[1])), L::sqrt(L::add(L::mul(dcx, dcx), L::mul(dcz, dcz)))));
+        V feature = L::min(one, L::abs(L::sub(gradient[0], gradient[1])));
+        V error = L::add(colour, L::mul(feature, L::sub(one, colour)));
+
+        total = L::add(total, error);
+        worst = L::max(worst, error);
+    }
+    sum += L::sum(total);
+    peak = std::max(peak, L::peak(worst));
+}
+
+//Partial results of one tile
+struct TileResult {
+    double squaredError = 0.0;
+    double ssim = 0.0;
+    int windows = 0;
+    double frameSums[5] = {0.0, 0.0, 0.0, 0.0, 0.0}; //SSIM sums of frames smaller than a window
+    double flip = 0.0;
+    float flipMax = 0.0f;
+};
+
+//Per thread buffers, reused from tile to tile
+struct TileScratch {
+    std::vector<float> channels[2][3]; //RGB of both frames
+    std::vector<float> luma[2];
+    std::vector<float> values;         //One row as floats before deinterleaving
+    std::vector<float> columns[5];
+    std::vector<float> blocks[2][5];   //Two block rows of SSIM sums
+};
+
+//Rows y0..y1 of both frames. PSNR and the perceptual difference cover these rows, SSIM the windows
+//starting in them, so the tile converts a row above and the rows below the last window it needs
+static void compare_tile(const ImageView* frames, int y0, int y1, TileScratch& s, TileResult& result) {
+    const int width = frames[0].width, height = frames[0].height;
+    const int first = std::max(0, y0 - 1);
+    const int last = std::min(height, y1 + SSIM_WINDOW - SSIM_STRIDE);
+    const size_t lumaStride = width + 2;
+
+    s.values.resize(static_cast<size_t>(width) * 4);
+    for (int i = 0; i < 2; i++) {
+        for (int c = 0; c < 3; c++)
+            s.channels[i][c].resize(static_cast<size_t>(last - first) * width);
+        s.luma[i].resize(static_cast<size_t>(last - first) * lumaStride);
+
+        for (int y = first; y < last; y++) {
+            row_to_float(row_pointer(frames[i], y), frames[i].format, s.values.data(), width * 4);
+
+            size_t offset = static_cast<size_t>(y - first) * width;
+            float* r = s.channels[i][0].data() + offset;
+            float* g = s.channels[i][1].data() + offset;
+            float* b = s.channels[i][2].data() + offset;
+            float* luma = s.luma[i].data() + (y - first) * lumaStride + 1;
+            for (int x = 0; x < width; x++) {
+                r[x] = displayed(s.values[x * 4]);
+                g[x] = displayed(s.values[x * 4 + 1]);
+                b[x] = displayed(s.values[x * 4 + 2]);
+                luma[x] = LUMA_R * r[x] + LUMA_G * g[x] + LUMA_B * b[x];
+            }
+            luma[-1] = luma[0];
+            luma[width] = luma[width - 1];
+        }
+    }
+
+    auto channel = [&](int i, int c, int y) { return s.channels[i][c].data() + static_cast<size_t>(y - first) * width; };
+    auto luma = [&](int i, int y) { return s.luma[i].data() + (y - first) * lumaStride + 1; };
+
+    for (int y = y0; y < y1; y++) {
+        for (int c = 0; c < 3; c++) {
+            int x = 0;
+            result.squaredError += squared_error<VectorLane>(channel(0, c, y), channel(1, c, y), x, width);
+            result.squaredError += squared_error<ScalarLane>(channel(0, c, y), channel(1, c, y), x, width);
+        }
+
+        FlipRow row;
+        for (int i = 0; i < 2; i++) {
+            row.r[i] = channel(i, 0, y);
+            row.g[i] = channel(i, 1, y);
+            row.b[i] = channel(i, 2, y);
+            row.luma[i] = luma(i, y);
+            row.up[i] = luma(i, std::max(y - 1, 0));
+            row.down[i] = luma(i, std::min(y + 1, height - 1));
+        }
+        int x = 0;
+        float sum = 0.0f;
+        flip_row<VectorLane>(row, x, width, sum, result.flipMax);
+        flip_row<ScalarLane>(row, x, width, sum, result.flipMax);
+        result.flip += sum;
+    }
+
+    //Too small for a window, the whole frame is one
+    if (width < SSIM_WINDOW || height < SSIM_WINDOW) {
+        for (int y = y0; y < y1; y++) {
+            const float* a = luma(0, y);
+            const float* b = luma(1, y);
+            for (int x = 0; x < width; x++) {
+                result.frameSums[0] += a[x];
+                result.frameSums[1] += b[x];
+                result.frameSums[2] += a[x] * a[x];
+                result.frameSums[3] += b[x] * b[x];
+                result.frameSums[4] += a[x] * b[x];
+            }
+        }
+        return;
+    }
+
+    //Windows are pairs of 4x4 blocks across and down, so each block row is summed once
+    const int blocksAcross = width / SSIM_STRIDE;
+    const int windowsAcross = (width - SSIM_WINDOW) / SSIM_STRIDE + 1;
+    float* columns[5];
+    for (int q = 0; q < 5; q++) {
+        s.columns[q].resize(width);
+        columns[q] = s.columns[q].data();
+        s.blocks[0][q].resize(blocksAcross);
+        s.blocks[1][q].resize(blocksAcross);
+    }
+
+    auto sum_block_row = [&](int blockRow, std::vector<float>* out) {
+        const float* a[SSIM_STRIDE];
+        const float* b[SSIM_STRIDE];
+        for (int r = 0; r < SSIM_STRIDE; r++) {
+            a[r] = luma(0, blockRow * SSIM_STRIDE + r);
+            b[r] = luma(1, blockRow * SSIM_STRIDE + r);
+        }
+        int x = 0;
+        block_columns<VectorLane>(a, b, columns, x, blocksAcross * SSIM_STRIDE);
+        block_columns<ScalarLane>(a, b, columns, x, blocksAcross * SSIM_STRIDE);
+
+        for (int q = 0; q < 5; q++) {
+            for (int j = 0; j < blocksAcross; j++) {
+                const float* column = columns[q] + j * SSIM_STRIDE;
+                out[q][j] = column[0] + column[1] + column[2] + column[3];
+            }
+        }
+    };
+
+    int current = 0;
+    if (y0 + SSIM_WINDOW <= height)
+        sum_block_row(y0 / SSIM_STRIDE, s.blocks[current]);
+    for (int top = y0; top < y1 && top + SSIM_WINDOW <= height; top += SSIM_STRIDE) {
+        sum_block_row(top / SSIM_STRIDE + 1, s.blocks[1 - current]);
+
+        const float* upper[5];
+        const float* lower[5];
+        for (int q = 0; q < 5; q++) {
+            upper[q] = s.blocks[current][q].data();
+            lower[q] = s.blocks[1 - current][q].data();
+        }
+        int j = 0;
+        result.ssim += window_ssim<VectorLane>(upper, lower, j, windowsAcross);
+        result.ssim += window_ssim<ScalarLane>(upper, lower, j, windowsAcross);
+        result.windows += windowsAcross;
+
+        current = 1 - current;
+    }
+}
+
+int compare_images(const ImageView& a, const ImageView& b, ImageMetrics& metrics, int threads) {
+    if (a.width != b.width || a.height != b.height || a.width <= 0 || a.height <= 0) {
+        std::cerr << "Can't compare a " << a.width << "x" << a.height << " frame with a "
+                  << b.width << "x" << b.height << " one" << std::endl;
+        return -1;
+    }
+
+    const int tiles = (a.height + TILE_ROWS - 1) / TILE_ROWS;
+    if (threads <= 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, tiles);
+
+    //Threads take the next tile until none are left, each tile writes its own result
+    const ImageView frames[2] = {a, b};
+    std::vector<TileResult> results(tiles);
+    std::atomic<int> nextTile(0);
+    auto work = [&]() {
+        TileScratch scratch;
+        for (int tile; (tile = nextTile++) < tiles; ) {
+            compare_tile(frames, tile * TILE_ROWS, std::min(a.height, (tile + 1) * TILE_ROWS),
+                         scratch, results[tile]);
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (int i = 1; i < threads; i++)
+        pool.emplace_back(work);
+    work();
+    for (std::thread& thread : pool)
+        thread.join();
+
+    //Summed in tile order, so the result doesn't depend on the thread count
+    TileResult total;
+    for (const TileResult& tile : results) {
+        total.squaredError += tile.squaredError;
+        total.ssim += tile.ssim;
+        total.windows += tile.windows;
+        for (int q = 0; q < 5; q++)
+            total.frameSums[q] += tile.frameSums[q];
+        total.flip += tile.flip;
+        total.flipMax = std::max(total.flipMax, tile.flipMax);
+    }
+
+    double pixels = static_cast<double>(a.width) * a.height;
+    double mse = total.squaredError / (pixels * 3);
+    metrics.psnr = mse > 0.0 ? std::min(PSNR_IDENTICAL, -10.0 * std::log10(mse)) : PSNR_IDENTICAL;
+
+    if (total.windows) {
+        metrics.ssim = total.ssim / total.windows;
+    }
+    else {
+        const double* sums = total.frameSums;
+        double ma = sums[0] / pixels, mb = sums[1] / pixels;
+        double va = sums[2] / pixels - ma * ma;
+        double vb = sums[3] / pixels - mb * mb;
+        double cov = sums[4] / pixels - ma * mb;
+        metrics.ssim = ((2.0 * ma * mb + SSIM_C1) * (2.0 * cov + SSIM_C2))
+                       / ((ma * ma + mb * mb + SSIM_C1) * (va + vb + SSIM_C2));
+    }
+
+    metrics.flip = total.flip / pixels;
+    metrics.flipMax = total.flipMax;
+    return 0;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <cstddef>
+
+//Image error metrics for comparing rendered frames against a reference.
+//Frames are split into tiles of rows compared on a pool of threads. The kernels use AVX2, SSE2 or
+//NEON (AArch64), whichever the compiler targets, with a scalar fallback. Alpha is ignored and
+//values are clamped to [0, 1], as they would be displayed
+
+//Pixel layouts frames come in
+enum PixelFormat {
+    PIXEL_RGBA8,  //8 bit unsigned normalized, e.g. captured frames
+    PIXEL_RGBA16F //Half floats, e.g. float render targets or 16 bit images
+};
+
+//A frame in memory. Rows are `stride` bytes apart, 0 for tightly packed. A negative stride
+//from the last row reads a bottom-up buffer (as glReadPixels fills it) top-down
+struct ImageView {
+    const void* pixels = nullptr;
+    int width = 0;
+    int height = 0;
+    PixelFormat format = PIXEL_RGBA8;
+    ptrdiff_t stride = 0;
+};
+
+//What compare_images returns for identical frames instead of an infinite PSNR
+const double PSNR_IDENTICAL = 100.0;
+
+struct ImageMetrics {
+    double psnr = 0.0;    //Peak signal-to-noise ratio of RGB in dB, higher is closer
+    double ssim = 0.0;    //Mean structural similarity of Rec. 709 luma over 8x8 windows 4 pixels apart
+                          //(the whole frame when it is smaller than a window), 1 when identical
+    double flip = 0.0;    //Mean perceptual difference in [0, 1], 0 when identical
+    double flipMax = 0.0; //Worst pixel of it
+};
+
+//Compare `a` against the reference `b` of the same size on `threads` threads, 0 for one per core.
+//Returns -1 if the sizes differ.
+//
+//The perceptual difference is modelled on NVIDIA's FLIP without its contrast sensitivity filtering:
+//a colour error, the HyAB distance (|dL| plus the Euclidean chroma distance) in an opponent space of
+//the displayed values, is raised towards 1 by a feature error, the difference in luma gradient
+//magnitude, so edges that moved or appeared count even where colours are close
+int compare_images(const ImageView& a, const ImageView& b, ImageMetrics& metrics, int threads = 0);
+
+//Kernels compiled in: "avx2", "sse2", "neon" or "scalar"
+const char* metrics_kernels();
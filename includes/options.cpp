@@ -0,0 +1,400 @@
+#include "options.h"
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+void print_usage(const char* program) {
+    std::cout << "Usage: " << program << " [options] <glsl-fragment-shader>\n"
+              << "       " << program << " tune [options] <glsl-fragment-shader>\n"
+              << "       " << program << " compare [options] <image> <reference>\n"
+              << "Options:\n"
+              << "  --buffer-<a-d> <shader> Multi-pass buffer rendered before the image, read as iChannel0-3\n"
+              << "  --audio-channel <N> Bind the audio spectrum/waveform texture as iChannelN (0-3)\n"
+              << "  --audio-file <path> Play a WAV or FLAC file, its position drives iChannelTime\n"
+              << "  --sound <shader>  Play a Shadertoy mainSound(int samp, float time) shader rendered on the GPU\n"
+              << "  --audio-backend <portaudio|null|wav:path> Where audio goes (default portaudio, null when headless)\n"
+              << "  --headless        Render offscreen through EGL (no window or display needed)\n"
+              << "  --size <W>x<H>    Render resolution (default 200x200)\n"
+              << "  --no-cache        Always compile shaders, ignore the program binary cache\n"
+              << "  --watch           Hot reload the shaders when their files change\n"
+              << "  --fps <rate>      Fixed timestep: advance iTime by 1/rate per frame, as fast as possible\n"
+              << "  --start <seconds> iTime of the first frame (default 0)\n"
+              << "  --frames <N>      Render exactly N frames, then exit\n"
+              << "  --accumulate      Progressive accumulation for path tracers, restarts on mouse/resize\n"
+              << "  --dynamic-resolution <ms> Scale the image pass resolution to hit this GPU time\n"
+              << "  --min-scale <s>   Lowest dynamic resolution scale (default 0.25)\n"
+              << "  --sharpen <s>     Sharpen the dynamic resolution upscale, 0 is bilinear (default 0)\n"
+              << "  --interleave <2|4> Shade 1 of every 2 (checkerboard) or 4 (2x2) pixels per frame\n"
+              << "  --supersample <k> Render the image at k times the size in each direction (2-4)\n"
+              << "  --ss-filter <f>   Supersampling downsample filter: box (default) or lanczos\n"
+              << "  --ss-jitter       Move the supersampling grid every frame, converges with --accumulate\n"
+              << "  --foveate <r>     Full resolution within r frame heights of the focus, half and quarter beyond\n"
+              << "  --focus <x>,<y>|mouse Foveation focus as frame fractions from the bottom left, or iMouse\n"
+              << "  --quality <ms>    Pick the shader's // @quality knob values to hit this GPU time\n"
+              << "  --benchmark       Print GPU/CPU frame time statistics as JSON on exit\n"
+              << "  --dump-frames <P> Capture every frame to <P>_<frame>.ppm\n"
+              << "  --compare <P>     Compare every frame with <P>_<frame>.png or .ppm (PSNR, SSIM, FLIP-style)\n"
+              << "  --tolerance <t>   Exit with status 1 if a compared frame differs by more than t or has no reference\n"
+              << "  --capture-ring <N> Pixel buffer objects in the capture ring (default 3)\n"
+              << "  --output <path>   Stream frames as video to a file or named pipe, - for stdout\n"
+              << "  --format <fmt>    Video output format: y4m (default) or raw (RGBA)\n"
+              << std::endl;
+}
+
+void print_tune_usage(const char* program) {
+    std::cout << "Usage: " << program << " tune [options] <glsl-fragment-shader>\n"
+              << "Renders every combination of the shader's // @quality knobs headless, times it and\n"
+              << "compares it to the highest quality, then writes the Pareto front as a JSON profile\n"
+              << "Options:\n"
+              << "  --size <W>x<H>    Render resolution (default 200x200)\n"
+              << "  --times <t,...>   iTime of each reference frame (default 0,1,2,4)\n"
+              << "  --repeat <N>      Timed draws per frame, the median counts (default 5)\n"
+              << "  --steps <N>       Values tried per knob, spread over its range (default 4)\n"
+              << "  --metric <m>      Error the front is built on: ssim (default), psnr or flip\n"
+              << "  --output <path>   Where the profile goes, - for stdout (default)\n"
+              << std::endl;
+}
+
+void print_compare_usage(const char* program) {
+    std::cout << "Usage: " << program << " compare [options] <image> <reference>\n"
+              << "Prints PSNR, SSIM and a FLIP-style perceptual difference of two PNG or PPM images as JSON\n"
+              << "Options:\n"
+              << "  --threads <N>     Threads comparing tiles of rows (default one per core)\n"
+              << std::endl;
+}
+
+//Parse a "<W>x<H>" resolution string
+static int parse_size(const char* str, int& width, int& height) {
+    if (sscanf(str, "%dx%d", &width, &height) != 2 || width <= 0 || height <= 0) {
+        std::cerr << "Invalid size '" << str << "', expected <W>x<H>" << std::endl;
+        return -1;
+    }
+    return 0;
+}
+
+int parse_options(int argc, char** argv, Options& options) {
+    bool backendGiven = false;
+    for (int i = 1; i < argc; i++) {
+        const char* arg = argv[i];
+
+        //Options that take a value read it from the next argument
+        bool hasValue = i + 1 < argc;
+
+        if (!strncmp(arg, "--buffer-", 9) && arg[9] >= 'a' && arg[9] < 'a' + CHANNEL_COUNT && !arg[10] && hasValue) {
+            options.bufferPaths[arg[9] - 'a'] = argv[++i];
+        }
+        else if (!strcmp(arg, "--audio-channel") && hasValue) {
+            options.audioChannel = atoi(argv[++i]);
+            if (options.audioChannel < 0 || options.audioChannel >= CHANNEL_COUNT) {
+                std::cerr << "--audio-channel needs a channel between 0 and " << CHANNEL_COUNT - 1 << std::endl;
+                return -1;
+            }
+        }
+        else if (!strcmp(arg, "--audio-file") && hasValue) {
+            options.audioFile = argv[++i];
+        }
+        else if (!strcmp(arg, "--sound") && hasValue) {
+            options.soundPath = argv[++i];
+        }
+        else if (!strcmp(arg, "--audio-backend") && hasValue) {
+            if (parse_audio_backend(argv[++i], options.audioBackend, options.audioWavPath)) {
+                std::cerr << "--audio-backend needs portaudio, null or wav:<path>" << std::endl;
+                return -1;
+            }
+            backendGiven = true;
+        }
+        else if (!strcmp(arg, "--headless")) {
+            options.headless = true;
+        }
+        else if (!strcmp(arg, "--no-cache")) {
+            options.programCache = false;
+        }
+        else if (!strcmp(arg, "--watch")) {
+            options.watch = true;
+        }
+        else if (!strcmp(arg, "--size") && hasValue) {
+            if (parse_size(argv[++i], options.width, options.height))
+                return -1;
+        }
+        else if (!strcmp(arg, "--fps") && hasValue) {
+            options.fps = atof(argv[++i]);
+            if (options.fps <= 0.0) {
+                std::cerr << "--fps needs a positive rate" << std::endl;
+                return -1;
+            }
+        }
+        else if (!strcmp(arg, "--start") && hasValue) {
+            options.startTime = atof(argv[++i]);
+        }
+        else if (!strcmp(arg, "--frames") && hasValue) {
+            options.frames = strtoul(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(arg, "--accumulate")) {
+            options.accumulate = true;
+        }
+        else if (!strcmp(arg, "--dynamic-resolution") && hasValue) {
+            options.dynamicResolution = atof(argv[++i]);
+            if (options.dynamicResolution <= 0.0) {
+                std::cerr << "--dynamic-resolution needs a positive frame time in milliseconds" << std::endl;
+                return -1;
+            }
+        }
+        else if (!strcmp(arg, "--min-scale") && hasValue) {
+            options.minScale = static_cast<float>(atof(argv[++i]));
+            if (options.minScale <= 0.0f || options.minScale > 1.0f) {
+                std::cerr << "--min-scale needs a scale in (0, 1]" << std::endl;
+                return -1;
+            }
+        }
+        else if (!strcmp(arg, "--sharpen") && hasValue) {
+            options.sharpen = static_cast<float>(atof(argv[++i]));
+            if (options.sharpen < 0.0f) {
+                std::cerr << "--sharpen can't be negative" << std::endl;
+                return -1;
+            }
+        }
+        else if (!strcmp(arg, "--interleave") && hasValue) {
+            options.interleave = atoi(argv[++i]);
+            if (options.interleave != 2 && options.interleave != 4) {
+                std::cerr << "--interleave needs 2 or 4" << std::endl;
+                return -1;
+            }
+        }
+        else if (!strcmp(arg, "--supersample") && hasValue) {
+            options.supersample = atoi(argv[++i]);
+            if (options.supersample < 2 || options.supersample > 4) {
+                std::cerr << "--supersample needs a factor of 2 to 4" << std::endl;
+                return -1;
+            }
+        }
+        else if (!strcmp(arg, "--ss-filter") && hasValue) {
+            const char* filter = argv[++i];
+            if (!strcmp(filter, "box"))
+                options.downsampleFilter = DOWNSAMPLE_BOX;
+            else if (!strcmp(filter, "lanczos"))
+                options.downsampleFilter = DOWNSAMPLE_LANCZOS;
+            else {
+                std::cerr << "Unknown downsample filter '" << filter << "', expected box or lanczos" << std::endl;
+                return -1;
+            }
+        }
+        else if (!strcmp(arg, "--ss-jitter")) {
+            options.supersampleJitter = true;
+        }
+        else if (!strcmp(arg, "--foveate") && hasValue) {
+            options.foveate = static_cast<float>(atof(argv[++i]));
+            if (options.foveate <= 0.0f || options.foveate > 1.0f) {
+                std::cerr << "--foveate needs a radius in (0, 1]" << std::endl;
+                return -1;
+            }
+        }
+        else if (!strcmp(arg, "--focus") && hasValue) {
+            const char* focus = argv[++i];
+            if (!strcmp(focus, "mouse"))
+                options.focusMouse = true;
+            else if (sscanf(focus, "%f,%f", &options.focusX, &options.focusY) != 2) {
+                std::cerr << "Invalid focus '" << focus << "', expected <x>,<y> or mouse" << std::endl;
+                return -1;
+            }
+        }
+        else if (!strcmp(arg, "--quality") && hasValue) {
+            options.quality = atof(argv[++i]);
+            if (options.quality <= 0.0) {
+                std::cerr << "--quality needs a positive frame time in milliseconds" << std::endl;
+                return -1;
+            }
+        }
+        else if (!strcmp(arg, "--benchmark")) {
+            options.benchmark = true;
+        }
+        else if (!strcmp(arg, "--dump-frames") && hasValue) {
+            options.dumpPrefix = argv[++i];
+        }
+        else if (!strcmp(arg, "--compare") && hasValue) {
+            options.comparePrefix = argv[++i];
+        }
+        else if (!strcmp(arg, "--tolerance") && hasValue) {
+            options.tolerance = atof(argv[++i]);
+            if (options.tolerance <= 0.0 || options.tolerance > 1.0) {
+                std::cerr << "--tolerance needs a perceptual difference in (0, 1]" << std::endl;
+                return -1;
+            }
+        }
+        else if (!strcmp(arg, "--capture-ring") && hasValue) {
+            options.captureSlots = atoi(argv[++i]);
+            if (options.captureSlots < 1) {
+                std::cerr << "--capture-ring needs at least 1 slot" << std::endl;
+                return -1;
+            }
+        }
+        else if (!strcmp(arg, "--output") && hasValue) {
+            options.outputPath = argv[++i];
+        }
+        else if (!strcmp(arg, "--format") && hasValue) {
+            if (parse_video_format(argv[++i], options.outputFormat)) {
+                std::cerr << "Unknown video format '" << argv[i] << "', expected y4m or raw" << std::endl;
+                return -1;
+            }
+        }
+        else if (arg[0] == '-' && arg[1] == '-') {
+            std::cerr << "Unknown or incomplete option " << arg << std::endl;
+            return -1;
+        }
+        else {
+            options.shaderPath = arg;
+        }
+    }
+
+    if (options.shaderPath.empty())
+        return -1;
+
+    //Headless machines usually have no sound card
+    if (options.headless && !backendGiven)
+        options.audioBackend = AUDIO_NULL;
+
+    if (!options.outputPath.empty() + !options.dumpPrefix.empty() + !options.comparePrefix.empty() > 1) {
+        std::cerr << "Only one of --output, --dump-frames and --compare can be used" << std::endl;
+        return -1;
+    }
+
+    if (options.tolerance > 0.0 && options.comparePrefix.empty()) {
+        std::cerr << "--tolerance needs --compare" << std::endl;
+        return -1;
+    }
+
+    //Each of these owns the image pass target, only supersampling feeds into accumulation
+    bool resampled = options.dynamicResolution > 0.0 || options.interleave > 0 || options.foveate > 0.0f;
+    if (((options.dynamicResolution > 0.0) + (options.interleave > 0) + (options.supersample > 1)
+         + (options.foveate > 0.0f)) > 1
+        || (resampled && options.accumulate)) {
+        std::cerr << "Only one of --dynamic-resolution, --interleave, --supersample, --foveate and --accumulate "
+                     "can be used, except --supersample with --accumulate" << std::endl;
+        return -1;
+    }
+
+    //Two controllers chasing the same frame time would fight
+    if (options.quality > 0.0 && options.dynamicResolution > 0.0) {
+        std::cerr << "--quality and --dynamic-resolution can't be used together" << std::endl;
+        return -1;
+    }
+
+    if (options.supersampleJitter && options.supersample < 2) {
+        std::cerr << "--ss-jitter needs --supersample" << std::endl;
+        return -1;
+    }
+
+    if (!options.audioFile.empty() && !options.soundPath.empty()) {
+        std::cerr << "--audio-file and --sound can't be used together" << std::endl;
+        return -1;
+    }
+
+    if (options.audioChannel >= 0 && !options.bufferPaths[options.audioChannel].empty()) {
+        std::cerr << "iChannel" << options.audioChannel << " is already used by a buffer" << std::endl;
+        return -1;
+    }
+
+    return 0;
+}
+
+//Parse a comma separated list of times
+static int parse_times(const char* str, std::vector<float>& times) {
+    times.clear();
+    for (const char* item = str; *item; ) {
+        char* end;
+        times.push_back(strtof(item, &end));
+        if (end == item || (*end && *end != ',')) {
+            std::cerr << "Invalid times '" << str << "', expected comma separated seconds" << std::endl;
+            return -1;
+        }
+        item = *end ? end + 1 : end;
+    }
+    return times.empty() ? -1 : 0;
+}
+
+int parse_tune_options(int argc, char** argv, TuneOptions& options) {
+    //argv[1] is "tune"
+    for (int i = 2; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (!strcmp(arg, "--size") && hasValue) {
+            if (parse_size(argv[++i], options.width, options.height))
+                return -1;
+        }
+        else if (!strcmp(arg, "--times") && hasValue) {
+            if (parse_times(argv[++i], options.times))
+                return -1;
+        }
+        else if (!strcmp(arg, "--repeat") && hasValue) {
+            options.repeat = atoi(argv[++i]);
+            if (options.repeat < 1) {
+                std::cerr << "--repeat needs at least 1 draw" << std::endl;
+                return -1;
+            }
+        }
+        else if (!strcmp(arg, "--steps") && hasValue) {
+            options.steps = atoi(argv[++i]);
+            if (options.steps < 2) {
+                std::cerr << "--steps needs at least 2 values per knob" << std::endl;
+                return -1;
+            }
+        }
+        else if (!strcmp(arg, "--metric") && hasValue) {
+            arg = argv[++i];
+            if (!strcmp(arg, "ssim"))
+                options.metric = TUNE_SSIM;
+            else if (!strcmp(arg, "psnr"))
+                options.metric = TUNE_PSNR;
+            else if (!strcmp(arg, "flip"))
+                options.metric = TUNE_FLIP;
+            else {
+                std::cerr << "Unknown metric '" << arg << "', expected ssim, psnr or flip" << std::endl;
+                return -1;
+            }
+        }
+        else if (!strcmp(arg, "--output") && hasValue) {
+            options.outputPath = argv[++i];
+        }
+        else if (arg[0] == '-' && arg[1] == '-') {
+            std::cerr << "Unknown or incomplete option " << arg << std::endl;
+            return -1;
+        }
+        else {
+            options.shaderPath = arg;
+        }
+    }
+
+    return options.shaderPath.empty() ? -1 : 0;
+}
+
+int parse_compare_options(int argc, char** argv, CompareOptions& options) {
+    //argv[1] is "compare"
+    int images = 0;
+    for (int i = 2; i < argc; i++) {
+        const char* arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (!strcmp(arg, "--threads") && hasValue) {
+            options.threads = atoi(argv[++i]);
+            if (options.threads < 1) {
+                std::cerr << "--threads needs at least 1 thread" << std::endl;
+                return -1;
+            }
+        }
+        else if (arg[0] == '-' && arg[1] == '-') {
+            std::cerr << "Unknown or incomplete option " << arg << std::endl;
+            return -1;
+        }
+        else if (images < 2) {
+            options.paths[images++] = arg;
+        }
+        else {
+            std::cerr << "Compare takes two images" << std::endl;
+            return -1;
+        }
+    }
+
+    return images == 2 ? 0 : -1;
+}
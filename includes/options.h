@@ -0,0 +1,101 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "video_sink.h"
+#include "uniforms.h"
+#include "audio_backend.h"
+#include "supersample.h"
+
+//Command line options for a ShadeD run
+struct Options {
+    std::string shaderPath;
+    std::string bufferPaths[CHANNEL_COUNT]; //Buffer A-D shaders, empty when unused
+    int audioChannel = -1;                  //iChannel showing the audio spectrum/waveform, -1 for none
+    std::string audioFile;                  //WAV/FLAC file to play instead of the test tone
+    std::string soundPath;                  //mainSound shader to play instead of the test tone
+    AudioBackendType audioBackend = AUDIO_PORTAUDIO; //Null when headless unless --audio-backend is given
+    std::string audioWavPath;               //Output of the WAV backend
+
+    int width  = 200;
+    int height = 200;
+
+    bool headless = false; //Render offscreen through EGL instead of a GLFW window
+    bool programCache = true; //Reuse linked program binaries from the disk cache
+    bool watch = false;       //Recompile shaders in the background when their files change
+
+    std::string dumpPrefix; //Write every frame as <prefix>_<frame>.ppm when set
+    std::string comparePrefix; //Compare every frame with <prefix>_<frame>.png/.ppm when set
+    double tolerance = 0.0;    //Mean perceptual difference a compared frame may have, 0 accepts any
+    int captureSlots = 3;   //PBOs in the readback ring, frames are mapped this many frames late
+
+    double fps = 0.0;            //Drive iTime from a synthetic clock at this rate, 0 follows the wall clock
+    double startTime = 0.0;      //iTime of the first frame
+    unsigned long frames = 0;    //Stop after this many frames, 0 runs until closed/interrupted
+
+    bool accumulate = false;     //Blend frames into a running mean, restarting when the view changes
+
+    double dynamicResolution = 0.0; //Target GPU milliseconds of the image pass, 0 renders at full size
+    float minScale = 0.25f;         //Lowest render scale dynamic resolution may pick
+    float sharpen = 0.0f;           //Unsharp mask strength of the upscale at the lowest scale, 0 is bilinear
+
+    int interleave = 0;             //Shade 1 of every 2 or 4 image pixels per frame, 0 shades them all
+
+    int supersample = 1;            //Image pass rendered this many times larger in each direction
+    DownsampleFilter downsampleFilter = DOWNSAMPLE_BOX;
+    bool supersampleJitter = false; //Rotated-grid offset of the samples, changing every frame
+
+    float foveate = 0.0f;           //Radius of the full resolution zone as a fraction of the height, 0 disables
+    bool focusMouse = false;        //Foveate around iMouse instead of (focusX, focusY)
+    float focusX = 0.5f;            //Fraction of the frame from the bottom left
+    float focusY = 0.5f;
+
+    double quality = 0.0;           //Target GPU milliseconds of the image pass for the @quality knobs, 0 disables
+
+    bool benchmark = false;      //Time every frame on the GPU and CPU, print statistics as JSON on exit
+
+    std::string outputPath;             //Stream frames as video to this path, "-" for stdout
+    VideoFormat outputFormat = VIDEO_Y4M;
+};
+
+//What `shaded tune` measures the variants against the reference by
+enum TuneMetric {
+    TUNE_SSIM,
+    TUNE_PSNR,
+    TUNE_FLIP
+};
+
+//Command line options of `shaded tune`
+struct TuneOptions {
+    std::string shaderPath;
+    int width  = 200;
+    int height = 200;
+
+    std::vector<float> times = {0.0f, 1.0f, 2.0f, 4.0f}; //iTime of each reference frame
+    int repeat = 5;              //Timed draws per frame, the median counts
+    int steps = 4;               //Values tried per knob, evenly spread over its range
+    TuneMetric metric = TUNE_SSIM;
+
+    std::string outputPath = "-"; //JSON profile, - for stdout
+};
+
+//Command line options of `shaded compare`
+struct CompareOptions {
+    std::string paths[2]; //Frame, then the reference
+    int threads = 0;      //0 for one per core
+};
+
+//Print the command line usage
+void print_usage(const char* program);
+void print_tune_usage(const char* program);
+void print_compare_usage(const char* program);
+
+//Parse argv into options, returns -1 on invalid arguments
+int parse_options(int argc, char** argv, Options& options);
+
+//Parse the arguments after `tune`, returns -1 on invalid arguments
+int parse_tune_options(int argc, char** argv, TuneOptions& options);
+
+//Parse the arguments after `compare`, returns -1 on invalid arguments
+int parse_compare_options(int argc, char** argv, CompareOptions& options);
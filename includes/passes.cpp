@@ -0,0 +1,118 @@
+#include "passes.h"
+#include "program_cache.h"
+
+#include <iostream>
+
+//(Re)create the two float targets of a buffer, cleared to zero
+static bool allocate_targets(BufferPass& pass, int width, int height) {
+    if (!pass.textures[0]) {
+        glGenTextures(2, pass.textures);
+        glGenFramebuffers(2, pass.framebuffers);
+    }
+
+    bool complete = true;
+    for (int i = 0; i < 2; i++) {
+        glBindTexture(GL_TEXTURE_2D, pass.textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, width, height, 0, GL_RGBA, GL_FLOAT, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffers[i]);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pass.textures[i], 0);
+        complete = complete && glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+
+        glClearColor(0.0f, 0.0f, 0.0f, 0.0f);
+        glClear(GL_COLOR_BUFFER_BIT);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    pass.current = 0;
+    return complete;
+}
+
+int init_buffer_pass(PassChain& chain, int channel, const char* source, int width, int height) {
+    BufferPass& pass = chain.buffers[channel];
+
+    pass.program = create_cached_program(source);
+    if (!pass.program)
+        return -1;
+
+    reflect_uniforms(pass.program, pass.uniforms);
+    glUseProgram(pass.program);
+    bind_channel_units(pass.uniforms);
+
+    if (!allocate_targets(pass, width, height)) {
+        std::cerr << "Buffer " << static_cast<char>('A' + channel) << " framebuffer is not complete" << std::endl;
+        return -1;
+    }
+
+    chain.width = width;
+    chain.height = height;
+    return 0;
+}
+
+void replace_buffer_program(PassChain& chain, int channel, GLuint program) {
+    BufferPass& pass = chain.buffers[channel];
+
+    glDeleteProgram(pass.program);
+    pass.program = program;
+
+    reflect_uniforms(pass.program, pass.uniforms);
+    glUseProgram(pass.program);
+    bind_channel_units(pass.uniforms);
+}
+
+void resize_pass_chain(PassChain& chain, int width, int height) {
+    for (BufferPass& pass : chain.buffers) {
+        if (pass.program)
+            allocate_targets(pass, width, height);
+    }
+    chain.width = width;
+    chain.height = height;
+}
+
+void render_buffer_passes(PassChain& chain, const FrameState& state, GLuint VAO) {
+    glViewport(0, 0, chain.width, chain.height);
+    glBindVertexArray(VAO);
+
+    for (BufferPass& pass : chain.buffers) {
+        if (!pass.program)
+            continue;
+
+        //Read the latest results (including this buffer's previous frame), write the other target
+        bind_channel_textures(chain);
+        glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffers[1 - pass.current]);
+
+        glUseProgram(pass.program);
+        push_frame_uniforms(pass.uniforms, state);
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+
+        pass.current = 1 - pass.current;
+    }
+}
+
+void bind_channel_textures(const PassChain& chain) {
+    for (int channel = 0; channel < CHANNEL_COUNT; channel++) {
+        const BufferPass& pass = chain.buffers[channel];
+        glActiveTexture(GL_TEXTURE0 + channel);
+        glBindTexture(GL_TEXTURE_2D, pass.program ? pass.textures[pass.current] : chain.inputs[channel]);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+void destroy_pass_chain(PassChain& chain) {
+    for (BufferPass& pass : chain.buffers) {
+        if (!pass.program)
+            continue;
+
+        glDeleteProgram(pass.program);
+        glDeleteFramebuffers(2, pass.framebuffers);
+        glDeleteTextures(2, pass.textures);
+    }
+
+    //Inputs belong to whoever set them
+    chain = PassChain();
+}
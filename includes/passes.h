@@ -0,0 +1,41 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "uniforms.h"
+
+//Shadertoy style "Buffer A-D" passes. Each buffer renders into a ping-pong pair of float
+//targets and is visible as iChannel<N> (A = 0 ... D = 3) to every pass: passes after it see
+//this frame's result, the buffer itself and passes before it see the previous frame's
+struct BufferPass {
+    GLuint program = 0;
+    UniformTable uniforms;
+
+    GLuint framebuffers[2] = {0, 0};
+    GLuint textures[2] = {0, 0};
+    int current = 0; //Index of the texture holding the latest result
+};
+
+struct PassChain {
+    BufferPass buffers[CHANNEL_COUNT];
+    GLuint inputs[CHANNEL_COUNT] = {0, 0, 0, 0}; //Textures bound to channels without a buffer, e.g. audio
+    int width = 0;
+    int height = 0;
+};
+
+//Compile a buffer shader into slot `channel` and allocate its targets
+int init_buffer_pass(PassChain& chain, int channel, const char* source, int width, int height);
+
+//Swap a buffer's program for a newly linked one, e.g. after a hot reload. Its contents are kept
+void replace_buffer_program(PassChain& chain, int channel, GLuint program);
+
+//Reallocate every buffer's targets at a new size, their contents restart from black
+void resize_pass_chain(PassChain& chain, int width, int height);
+
+//Render every buffer in order A-D with the quad in `VAO`. Leaves the viewport at the chain size
+void render_buffer_passes(PassChain& chain, const FrameState& state, GLuint VAO);
+
+//Bind each buffer's latest result (or the channel's input texture) to texture unit <channel>
+void bind_channel_textures(const PassChain& chain);
+
+void destroy_pass_chain(PassChain& chain);
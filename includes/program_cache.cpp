@@ -0,0 +1,158 @@
+#include "program_cache.h"
+#include "shader.h"
+
+#include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+//File layout: magic, binary format, payload
+static const char cacheMagic[4] = { 'S', 'H', 'D', 'B' };
+
+static bool cacheDisabled = false;
+
+void disable_program_cache() {
+    cacheDisabled = true;
+}
+
+//64-bit FNV-1a, plenty for telling shader sources apart
+static unsigned long long hash_bytes(unsigned long long hash, const char* data) {
+    for (const unsigned char* p = reinterpret_cast<const unsigned char*>(data); *p; p++) {
+        hash ^= *p;
+        hash *= 0x100000001b3ULL;
+    }
+    //Separator so ("ab", "c") and ("a", "bc") differ
+    hash ^= 0xff;
+    hash *= 0x100000001b3ULL;
+    return hash;
+}
+
+//$XDG_CACHE_HOME/shaded, created on demand. Empty if there is nowhere to put it
+static std::string cache_directory() {
+    std::string dir;
+    const char* xdg = getenv("XDG_CACHE_HOME");
+    const char* home = getenv("HOME");
+
+    if (xdg && xdg[0])
+        dir = xdg;
+    else if (home && home[0])
+        dir = std::string(home) + "/.cache";
+    else
+        return "";
+
+    mkdir(dir.c_str(), 0755);
+    dir += "/shaded";
+    mkdir(dir.c_str(), 0755);
+    return dir;
+}
+
+static std::string cache_path(const char* fragmentSource) {
+    std::string dir = cache_directory();
+    if (dir.empty())
+        return "";
+
+    unsigned long long hash = 0xcbf29ce484222325ULL;
+    hash = hash_bytes(hash, vertexShaderSource);
+    hash = hash_bytes(hash, fragmentSource);
+    hash = hash_bytes(hash, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+    hash = hash_bytes(hash, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+    hash = hash_bytes(hash, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+
+    char name[32];
+    snprintf(name, sizeof(name), "/%016llx.bin", hash);
+    return dir + name;
+}
+
+static GLuint load_binary(const std::string& path) {
+    FILE* file = fopen(path.c_str(), "rb");
+    if (!file)
+        return 0;
+
+    char magic[4];
+    GLenum format = 0;
+    std::vector<char> binary;
+
+    bool ok = fread(magic, 1, 4, file) == 4 && !memcmp(magic, cacheMagic, 4)
+              && fread(&format, sizeof(format), 1, file) == 1;
+    if (ok) {
+        fseek(file, 0, SEEK_END);
+        long size = ftell(file) - static_cast<long>(4 + sizeof(format));
+        fseek(file, 4 + sizeof(format), SEEK_SET);
+
+        ok = size > 0;
+        if (ok) {
+            binary.resize(size);
+            ok = fread(binary.data(), 1, size, file) == static_cast<size_t>(size);
+        }
+    }
+    fclose(file);
+
+    if (!ok)
+        return 0;
+
+    GLuint program = glCreateProgram();
+    glProgramBinary(program, format, binary.data(), static_cast<GLsizei>(binary.size()));
+
+    GLint linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (!linked) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+static void store_binary(const std::string& path, GLuint program) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0)
+        return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+    //Write to a temporary name and rename, so a concurrent start never reads half a file
+    std::string temporary = path + ".tmp" + std::to_string(getpid());
+    FILE* file = fopen(temporary.c_str(), "wb");
+    if (!file)
+        return;
+
+    bool ok = fwrite(cacheMagic, 1, 4, file) == 4
+              && fwrite(&format, sizeof(format), 1, file) == 1
+              && fwrite(binary.data(), 1, binary.size(), file) == binary.size();
+    ok = fclose(file) == 0 && ok;
+
+    if (!ok || rename(temporary.c_str(), path.c_str()))
+        unlink(temporary.c_str());
+}
+
+GLuint create_cached_program(const char* fragmentSource) {
+    //The entry points are core in 4.1. A 3.3 context can still report binary formats through
+    //ARB_get_program_binary, which the loader doesn't load, so check the functions themselves
+    if (cacheDisabled || !glProgramBinary || !glGetProgramBinary || !glProgramParameteri)
+        return create_program(fragmentSource);
+
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    if (formats < 1)
+        return create_program(fragmentSource);
+
+    std::string path = cache_path(fragmentSource);
+    if (path.empty())
+        return create_program(fragmentSource);
+
+    GLuint program = load_binary(path);
+    if (program)
+        return program;
+
+    program = create_program(fragmentSource, true);
+    if (program)
+        store_binary(path, program);
+
+    return program;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <glad/glad.h>
+
+//Disk cache of linked program binaries under $XDG_CACHE_HOME/shaded (~/.cache/shaded).
+//Entries are keyed by a hash of the complete shader sources (including anything injected
+//into them) and the driver's vendor/renderer/version strings, so a driver update or an
+//edited shader simply misses. A binary the driver rejects falls back to a normal compile
+
+//Like create_program, but loads the program with glProgramBinary on a cache hit and
+//stores the binary after a fresh link otherwise
+GLuint create_cached_program(const char* fragmentSource);
+
+//Skip the cache entirely, e.g. while debugging driver issues
+void disable_program_cache();
@@ -0,0 +1,228 @@
+#include "quality.h"
+#include "shader.h"
+#include "program_cache.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+
+//Weight of a new measurement in a level's smoothed cost
+static const double SMOOTHING = 0.2;
+
+//Measurements of a level before deciding to leave it, results arrive a few frames late
+static const int SETTLE_MEASUREMENTS = 8;
+
+//Step down above this fraction of the target, step up below the other
+static const double DOWNGRADE = 1.05;
+static const double UPGRADE = 0.75;
+
+//Frames before a level that missed the target may be tried again
+static const unsigned long RETRY_FRAMES = 600;
+
+std::vector<QualityKnob> parse_quality_knobs(const std::string& source) {
+    std::vector<QualityKnob> knobs;
+    std::istringstream lines(source);
+    std::string line;
+
+    for (int number = 1; std::getline(lines, line); number++) {
+        size_t comment = line.find("//");
+        size_t tag = line.find("@quality", comment == std::string::npos ? 0 : comment);
+        if (comment == std::string::npos || tag == std::string::npos)
+            continue;
+
+        char name[64];
+        QualityKnob knob;
+        if (sscanf(line.c_str() + tag + 8, "%63s %d..%d", name, &knob.lo, &knob.hi) != 3 || knob.lo > knob.hi) {
+            std::cerr << "Ignoring line " << number << ", expected // @quality NAME lo..hi" << std::endl;
+            continue;
+        }
+        knob.name = name;
+        knobs.push_back(knob);
+    }
+    return knobs;
+}
+
+std::string quality_defines(const std::vector<QualityKnob>& knobs, const std::vector<int>& values) {
+    std::string defines;
+    for (size_t i = 0; i < knobs.size(); i++)
+        defines += "#define " + knobs[i].name + " " + std::to_string(values[i]) + "\n";
+    return defines;
+}
+
+std::string quality_prelude(const QualityController& qc, int level) {
+    return qc.prelude + "\n" + quality_defines(qc.knobs, qc.levels[level]);
+}
+
+std::string quality_source(const QualityController& qc, int level) {
+    return insert_after_version(qc.source, quality_prelude(qc, level));
+}
+
+//Every knob moves from its lowest to its highest value together. Levels that round to the same values are dropped
+static void build_levels(QualityController& qc) {
+    qc.levels.clear();
+    for (int step = 0; step < QUALITY_LEVELS; step++) {
+        std::vector<int> values;
+        for (const QualityKnob& knob : qc.knobs)
+            values.push_back(knob.lo + ((knob.hi - knob.lo) * step + (QUALITY_LEVELS - 1) / 2) / (QUALITY_LEVELS - 1));
+
+        if (qc.levels.empty() || qc.levels.back() != values)
+            qc.levels.push_back(values);
+    }
+
+    size_t count = qc.levels.size();
+    qc.programs.assign(count, 0);
+    qc.costs.assign(count, 0.0);
+    qc.measuredAt.assign(count, 0);
+    qc.compiles.clear();
+    for (size_t i = 0; i < count; i++)
+        qc.compiles.emplace_back(new AsyncProgram());
+
+    qc.level = static_cast<int>(count) - 1;
+    qc.measurements = 0;
+}
+
+static void compile_lower_levels(QualityController& qc) {
+    for (int level = 0; level < qc.level; level++)
+        start_async_compile(*qc.compiler, *qc.compiles[level], quality_source(qc, level));
+}
+
+int init_quality_controller(QualityController& qc, const std::string& source, const std::string& prelude,
+                            double targetMs, AsyncCompiler& compiler, GLuint& program) {
+    qc.source = source;
+    qc.prelude = prelude;
+    qc.knobs = parse_quality_knobs(source);
+    if (qc.knobs.empty()) {
+        std::cerr << "The shader has no // @quality NAME lo..hi knobs to control" << std::endl;
+        return -1;
+    }
+
+    qc.targetMs = targetMs;
+    qc.compiler = &compiler;
+    build_levels(qc);
+
+    program = create_cached_program(quality_source(qc, qc.level).c_str());
+    if (!program)
+        return -1;
+    qc.programs[qc.level] = program;
+
+    compile_lower_levels(qc);
+    init_gpu_timer(qc.timer);
+
+    std::cerr << "Quality control over " << qc.knobs.size() << " knobs in " << qc.levels.size() << " levels" << std::endl;
+    return 0;
+}
+
+void begin_quality_timer(QualityController& qc) {
+    begin_gpu_range(qc.timer);
+}
+
+void end_quality_timer(QualityController& qc) {
+    end_gpu_range(qc.timer, qc.level);
+    qc.frame++;
+}
+
+//Nearest compiled level from `level` in direction `step`, -1 if there is none
+static int next_ready(const QualityController& qc, int level, int step) {
+    for (int next = level + step; next >= 0 && next < static_cast<int>(qc.levels.size()); next += step) {
+        if (qc.programs[next])
+            return next;
+    }
+    return -1;
+}
+
+bool update_quality(QualityController& qc, GLuint& program) {
+    for (size_t i = 0; i < qc.compiles.size(); i++) {
+        bool done = false;
+        if (async_compile_pending(*qc.compiles[i])) {
+            GLuint linked = finish_async_compile(*qc.compiles[i], done);
+            if (done)
+                qc.programs[i] = linked;
+        }
+    }
+
+    double ms, level;
+    while (read_gpu_range(qc.timer, ms, level)) {
+        //Only a ladder that changed under a range in flight could tag it past the end
+        int measured = static_cast<int>(level);
+        if (measured < 0 || measured >= static_cast<int>(qc.costs.size()))
+            continue;
+        double& cost = qc.costs[measured];
+        cost = cost > 0.0 ? cost + (ms - cost) * SMOOTHING : ms;
+        qc.measuredAt[measured] = qc.frame;
+
+        if (measured == qc.level)
+            qc.measurements++;
+    }
+
+    if (qc.measurements < SETTLE_MEASUREMENTS)
+        return false;
+
+    int next = -1;
+    double cost = qc.costs[qc.level];
+    if (cost > qc.targetMs * DOWNGRADE) {
+        next = next_ready(qc, qc.level, -1);
+    }
+    else if (cost < qc.targetMs * UPGRADE) {
+        next = next_ready(qc, qc.level, 1);
+
+        bool missed = next >= 0 && qc.costs[next] > qc.targetMs;
+        if (missed && qc.frame - qc.measuredAt[next] < RETRY_FRAMES)
+            next = -1;
+    }
+
+    if (next < 0)
+        return false;
+
+    qc.level = next;
+    qc.measurements = 0;
+    program = qc.programs[next];
+    return true;
+}
+
+//Drop every variant, including the one in use
+static void release_levels(QualityController& qc) {
+    for (auto& compile : qc.compiles)
+        cancel_async_compile(*compile);
+    for (GLuint program : qc.programs) {
+        if (program)
+            glDeleteProgram(program);
+    }
+}
+
+void reload_quality_controller(QualityController& qc, const std::string& source, GLuint& program) {
+    std::string compiledWith = quality_prelude(qc, static_cast<int>(qc.levels.size()) - 1);
+    release_levels(qc);
+
+    std::vector<QualityKnob> knobs = parse_quality_knobs(source);
+    if (knobs.empty())
+        std::cerr << "The reloaded shader has no @quality knobs, keeping the previous ones" << std::endl;
+    else
+        qc.knobs = knobs;
+    qc.source = source;
+
+    build_levels(qc);
+
+    //Knobs added, renamed or with a new highest value. The program from the reloader is only
+    //kept if the new defines fail where the old ones linked
+    if (quality_prelude(qc, qc.level) != compiledWith) {
+        GLuint recompiled = create_cached_program(quality_source(qc, qc.level).c_str());
+        if (recompiled) {
+            glDeleteProgram(program);
+            program = recompiled;
+        }
+    }
+    qc.programs[qc.level] = program;
+    compile_lower_levels(qc);
+
+    //Ranges in flight measured the previous programs and are tagged with their levels
+    destroy_gpu_timer(qc.timer);
+    init_gpu_timer(qc.timer);
+}
+
+void destroy_quality_controller(QualityController& qc) {
+    release_levels(qc);
+    destroy_gpu_timer(qc.timer);
+
+    qc = QualityController();
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "async_compile.h"
+#include "gpu_timer.h"
+
+//Variants compiled between each knob's lowest and highest value
+const int QUALITY_LEVELS = 5;
+
+//A constant the shader leaves to the controller, annotated with `// @quality NAME lo..hi`.
+//The shader keeps a default for runs without a controller:
+//    // @quality NUM_STEPS 4..16
+//    #ifndef NUM_STEPS
+//    #define NUM_STEPS 8
+//    #endif
+struct QualityKnob {
+    std::string name;
+    int lo = 0;
+    int hi = 0;
+};
+
+//Every @quality annotation of `source`, malformed ones are reported and skipped
+std::vector<QualityKnob> parse_quality_knobs(const std::string& source);
+
+//#define lines setting the knobs to `values`
+std::string quality_defines(const std::vector<QualityKnob>& knobs, const std::vector<int>& values);
+
+//Runtime quality control of the image shader. A ladder of variants, from every knob at its
+//lowest value to every knob at its highest, is compiled in the background (the highest up front,
+//it is where rendering starts). The GPU time of the image pass is measured with timestamp queries
+//and smoothed per level; a level slower than the target steps down to the nearest compiled cheaper
+//one, a level well under it steps up unless the next one is known to miss (that knowledge expires,
+//so a lighter scene gets another try)
+struct QualityController {
+    std::string source;  //Image shader as read from its file
+    std::string prelude; //Inserted before the defines, e.g. for interleaved rendering
+    std::vector<QualityKnob> knobs;
+
+    std::vector<std::vector<int>> levels; //Knob values of each level, cheapest first
+    std::vector<GLuint> programs;         //0 while compiling or if compiling failed
+    std::vector<std::unique_ptr<AsyncProgram>> compiles;
+    std::vector<double> costs;            //Smoothed GPU milliseconds, 0 until measured
+    std::vector<unsigned long> measuredAt; //Frame of each level's latest measurement
+
+    int level = 0;
+    int measurements = 0; //Of the current level since switching to it
+    double targetMs = 0.0;
+    unsigned long frame = 0;
+
+    AsyncCompiler* compiler = nullptr;
+    GpuTimer timer;
+};
+
+//Build the ladder for `source` and compile its highest level into `program`, the rest in the background
+int init_quality_controller(QualityController& qc, const std::string& source, const std::string& prelude,
+                            double targetMs, AsyncCompiler& compiler, GLuint& program);
+
+//What a level inserts after #version: the prelude and the knobs' defines
+std::string quality_prelude(const QualityController& qc, int level);
+
+//Source of a level, ready to compile
+std::string quality_source(const QualityController& qc, int level);
+
+//Bracket the image pass
+void begin_quality_timer(QualityController& qc);
+void end_quality_timer(QualityController& qc);
+
+//Collect compiles and timings. Returns true and the program to use when the level changes
+bool update_quality(QualityController& qc, GLuint& program);
+
+//The shader file changed: start over from `source`, with `program` (compiled from it with the
+//previous knobs at their highest) in use. If the annotations changed the highest level, it is
+//compiled again with the new values and returned in `program`
+void reload_quality_controller(QualityController& qc, const std::string& source, GLuint& program);
+
+void destroy_quality_controller(QualityController& qc);
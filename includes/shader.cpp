@@ -0,0 +1,142 @@
+#include "shader.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdlib>
+
+//Vertex shader of the rendering quad
+const char* vertexShaderSource =
+R"(#version 330 core
+layout (location = 0) in vec2 position;
+layout (location = 1) in vec2 inTexCoord;
+
+out vec2 texCoord;
+void main(){
+    texCoord = inTexCoord;
+    gl_Position = vec4(position.x, position.y, 0.0f, 1.0f);
+})";
+
+//Check the compile errors
+bool checkCompileErrors(unsigned int shader, std::string type) {
+    int success;
+    char infoLog[1024];
+    if (type != "PROGRAM") {
+        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
+        if (!success) {
+            glGetShaderInfoLog(shader, 1024, NULL, infoLog);
+            std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+        }
+    }
+    else {
+        glGetProgramiv(shader, GL_LINK_STATUS, &success);
+        if (!success) {
+            glGetProgramInfoLog(shader, 1024, NULL, infoLog);
+            std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+        }
+    }
+    return success;
+}
+
+GLuint create_program(const char* fragmentSource, bool retrievable) {
+    //Vertex shader
+    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
+    glCompileShader(vertexShader);
+
+    //Fragment shader
+    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
+    glCompileShader(fragmentShader);
+    //Check for shader compile errors
+    bool compiled = checkCompileErrors(fragmentShader, "FRAGMENT");
+
+    //Link shaders
+    GLuint program = glCreateProgram();
+    if (retrievable)
+        glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glLinkProgram(program);
+    //Check for program linking errors
+    bool linked = compiled && checkCompileErrors(program, "PROGRAM");
+
+    //Remove/deallocate shaders
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    if (!linked) {
+        glDeleteProgram(program);
+        return 0;
+    }
+
+    return program;
+}
+
+int read_file(const char* filePath, std::string& fileString) {
+    std::string fragmentCode;
+    std::ifstream fShaderFile;
+
+    fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
+
+    try {
+      //First attempt to read the file
+      fShaderFile.open(filePath);
+      std::stringstream fShaderStream;
+
+      //Read file's buffer contents into streams
+      fShaderStream << fShaderFile.rdbuf();
+
+      //Close
+      fShaderFile.close();
+
+      //Stream into string
+      fileString = fShaderStream.str();
+
+    }
+    catch (std::ifstream::failure& e) {
+      std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
+      return -1;
+    }
+
+    return 0;
+}
+
+//The directive `line` starts with, ignoring indentation, e.g. "#version"
+static bool is_directive(const std::string& source, size_t line, const char* directive) {
+    size_t start = source.find_first_not_of(" \t", line);
+    return start != std::string::npos && source.compare(start, strlen(directive), directive) == 0;
+}
+
+std::string insert_after_version(const std::string& source, const std::string& code) {
+    int version = 110; //Without a #version line, GLSL 1.10 applies
+    size_t insert = 0;
+
+    for (size_t line = 0; line < source.size(); ) {
+        size_t next = source.find('\n', line);
+        next = next == std::string::npos ? source.size() : next + 1;
+
+        if (is_directive(source, line, "#version")) {
+            version = atoi(source.c_str() + source.find("#version", line) + 8);
+            insert = next;
+
+            //Extensions have to be enabled before anything else
+            while (insert < source.size() && is_directive(source, insert, "#extension")) {
+                size_t end = source.find('\n', insert);
+                insert = end == std::string::npos ? source.size() : end + 1;
+            }
+            break;
+        }
+        line = next;
+    }
+
+    int lines = static_cast<int>(std::count(source.begin(), source.begin() + insert, '\n'));
+    bool newline = insert == 0 || source[insert - 1] == '\n';
+
+    //From GLSL 3.30 on, #line N numbers the next line N, before that N + 1
+    std::string result = source.substr(0, insert) + (newline ? "" : "\n") + code + "\n";
+    result += "#line " + std::to_string(version >= 330 ? lines + 1 : lines) + "\n";
+    return result + source.substr(insert);
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <string>
+
+//Method to read file
+int read_file(const char* filePath, std::string& fileString);
+
+//Insert `code` after the #version (and #extension) lines of `source`, or at the top when it has
+//none. A #line directive keeps compile errors pointing at the original line numbers
+std::string insert_after_version(const std::string& source, const std::string& code);
+
+//Vertex shader of the rendering quad, shared by every fullscreen pass
+extern const char* vertexShaderSource;
+
+//For obtaining any errors from the shader program, returns false if compiling/linking failed
+bool checkCompileErrors(unsigned int shader, std::string type);
+
+//Compile a fragment shader and link it with the quad vertex shader, returns 0 on failure.
+//`retrievable` asks the driver to keep the binary around for glGetProgramBinary
+GLuint create_program(const char* fragmentSource, bool retrievable = false);
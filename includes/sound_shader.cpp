@@ -0,0 +1,141 @@
+#include "sound_shader.h"
+#include "program_cache.h"
+
+#include <iostream>
+#include <cstring>
+
+static const int BLOCK_SAMPLES = SOUND_BLOCK_WIDTH * SOUND_BLOCK_HEIGHT;
+
+//How long the first blocks may take to render, in nanoseconds
+static const GLuint64 STARTUP_TIMEOUT = 10000000000ull;
+
+//#version has to come first, the user code may or may not have one. After it comes a main
+//calling mainSound for the sample of each texel, row by row from the bottom
+static std::string wrap_source(const std::string& source) {
+    std::string body = source;
+    size_t version = body.find("#version");
+    if (version != std::string::npos) {
+        size_t end = body.find('\n', version);
+        body.erase(version, end == std::string::npos ? std::string::npos : end - version);
+    }
+
+    return "#version 330 core\n" + body +
+           "\nuniform int iSoundOffset;\n"
+           "uniform float iSampleRate;\n"
+           "out vec4 fragColor;\n"
+           "void main() {\n"
+           "    int samp = iSoundOffset + int(gl_FragCoord.y) * " + std::to_string(SOUND_BLOCK_WIDTH) + " + int(gl_FragCoord.x);\n"
+           "    fragColor = vec4(mainSound(samp, float(samp) / iSampleRate), 0.0, 1.0);\n"
+           "}\n";
+}
+
+static void render_block(SoundShader& sound, GLuint VAO) {
+    glBindFramebuffer(GL_FRAMEBUFFER, sound.framebuffer);
+    glViewport(0, 0, SOUND_BLOCK_WIDTH, SOUND_BLOCK_HEIGHT);
+    glUseProgram(sound.program);
+    glUniform1i(sound.offsetLocation, static_cast<GLint>(sound.nextSample));
+    glUniform1f(sound.sampleRateLocation, static_cast<float>(sound.sampleRate));
+    glBindVertexArray(VAO);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+
+    //Rows come back bottom-up, which is sample order
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, sound.pbo);
+    glReadPixels(0, 0, SOUND_BLOCK_WIDTH, SOUND_BLOCK_HEIGHT, GL_RG, GL_FLOAT, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    sound.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    sound.nextSample += BLOCK_SAMPLES;
+}
+
+//Move a finished block into the ring. `timeout` 0 only checks, returns false if it isn't done
+static bool collect_block(SoundShader& sound, GLuint64 timeout) {
+    GLenum status = glClientWaitSync(sound.fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout);
+    if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+        return false;
+
+    glDeleteSync(sound.fence);
+    sound.fence = 0;
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, sound.pbo);
+    const float* samples = static_cast<const float*>(
+        glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, BLOCK_SAMPLES * 2 * sizeof(float), GL_MAP_READ_BIT));
+    if (samples) {
+        write_audio_ring(sound.ring, samples, BLOCK_SAMPLES * 2);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    return true;
+}
+
+int init_sound_shader(SoundShader& sound, const std::string& source, int sampleRate, GLuint VAO) {
+    sound.program = create_cached_program(wrap_source(source).c_str());
+    if (!sound.program)
+        return -1;
+
+    sound.offsetLocation = glGetUniformLocation(sound.program, "iSoundOffset");
+    sound.sampleRateLocation = glGetUniformLocation(sound.program, "iSampleRate");
+    sound.sampleRate = sampleRate;
+
+    glGenTextures(1, &sound.texture);
+    glBindTexture(GL_TEXTURE_2D, sound.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RG32F, SOUND_BLOCK_WIDTH, SOUND_BLOCK_HEIGHT, 0, GL_RG, GL_FLOAT, nullptr);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &sound.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, sound.framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, sound.texture, 0);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete) {
+        std::cerr << "Sound shader framebuffer is not complete" << std::endl;
+        return -1;
+    }
+
+    glGenBuffers(1, &sound.pbo);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, sound.pbo);
+    glBufferData(GL_PIXEL_PACK_BUFFER, BLOCK_SAMPLES * 2 * sizeof(float), nullptr, GL_STREAM_READ);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    init_audio_ring(sound.ring, SOUND_RING_SIZE);
+
+    //Two blocks up front, the render loop tops the ring up from there. A block that is still
+    //pending after the timeout keeps its fence for update_sound_shader to collect
+    for (int i = 0; i < 2; i++) {
+        render_block(sound, VAO);
+        if (!collect_block(sound, STARTUP_TIMEOUT))
+            break;
+    }
+    return 0;
+}
+
+void update_sound_shader(SoundShader& sound, GLuint VAO) {
+    if (sound.fence && !collect_block(sound, 0))
+        return;
+
+    if (audio_ring_space(sound.ring) >= BLOCK_SAMPLES * 2)
+        render_block(sound, VAO);
+}
+
+void play_sound_frames(SoundShader& sound, float* output, unsigned long frames) {
+    size_t read = read_audio_ring(sound.ring, output, frames * 2);
+    memset(output + read, 0, (frames * 2 - read) * sizeof(float));
+
+    if (read < frames * 2)
+        sound.underruns.fetch_add(1, std::memory_order_relaxed);
+}
+
+void destroy_sound_shader(SoundShader& sound) {
+    if (!sound.program)
+        return;
+
+    if (sound.fence)
+        glDeleteSync(sound.fence);
+    glDeleteProgram(sound.program);
+    glDeleteFramebuffers(1, &sound.framebuffer);
+    glDeleteTextures(1, &sound.texture);
+    glDeleteBuffers(1, &sound.pbo);
+    sound.program = 0;
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <glad/glad.h>
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+#include "audio_ring.h"
+
+//Samples rendered per block: one RG32F texel per stereo sample, ~1.5s at 44.1kHz
+const int SOUND_BLOCK_WIDTH = 512;
+const int SOUND_BLOCK_HEIGHT = 128;
+
+//Interleaved stereo samples rendered ahead of playback, ~12s at 44.1kHz
+const size_t SOUND_RING_SIZE = 1 << 20;
+
+//Shadertoy sound shader: `vec2 mainSound(int samp, float time)` is evaluated on the GPU for a
+//whole block of samples at once. Blocks are read back through a pixel buffer object and a
+//fence, so the render thread never waits for them, and queued in a ring that the audio
+//callback copies from
+struct SoundShader {
+    GLuint program = 0;
+    GLint offsetLocation = -1;
+    GLint sampleRateLocation = -1;
+
+    GLuint framebuffer = 0;
+    GLuint texture = 0;
+    GLuint pbo = 0;
+    GLsync fence = 0; //Readback of the block in flight, 0 when there is none
+
+    int sampleRate = 0;
+    int64_t nextSample = 0; //First sample of the next block to render
+
+    AudioRing ring;
+    std::atomic<uint64_t> underruns{0};
+};
+
+//Compile the sound shader (the file only needs mainSound, a #version line is optional)
+//and render the first blocks synchronously so playback starts with a full buffer
+int init_sound_shader(SoundShader& sound, const std::string& source, int sampleRate, GLuint VAO);
+
+//Render thread: queue a finished readback and start the next block when the ring has room.
+//Changes the bound framebuffer, viewport and program
+void update_sound_shader(SoundShader& sound, GLuint VAO);
+
+//Audio callback: copy `frames` stereo frames out, silence if the GPU fell behind
+void play_sound_frames(SoundShader& sound, float* output, unsigned long frames);
+
+void destroy_sound_shader(SoundShader& sound);
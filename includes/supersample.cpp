@@ -0,0 +1,166 @@
+#include "supersample.h"
+#include "shader.h"
+
+#include <iostream>
+
+const char* supersampleJitterPrelude =
+R"(uniform vec2 shadedJitter;
+#define gl_FragCoord (gl_FragCoord + vec4(shadedJitter, 0.0, 0.0)))";
+
+//Each output pixel covers `factor` x `factor` source texels. Lanczos widens the footprint to
+//2 output pixels either side, its weights are those of the output pixel grid
+static const char* downsampleFragmentSource =
+R"(#version 330 core
+uniform sampler2D source;
+uniform int factor;
+uniform bool lanczos;
+out vec4 fragColor;
+
+const float PI = 3.14159265359;
+
+float lanczos2(float x) {
+    if (abs(x) < 1e-4)
+        return 1.0;
+    if (abs(x) >= 2.0)
+        return 0.0;
+    return 2.0 * sin(PI * x) * sin(PI * x / 2.0) / (PI * PI * x * x);
+}
+
+void main() {
+    ivec2 p = ivec2(gl_FragCoord.xy);
+    ivec2 size = textureSize(source, 0);
+
+    if (!lanczos) {
+        vec4 sum = vec4(0.0);
+        for (int y = 0; y < factor; y++)
+            for (int x = 0; x < factor; x++)
+                sum += texelFetch(source, p * factor + ivec2(x, y), 0);
+        fragColor = sum / float(factor * factor);
+        return;
+    }
+
+    //Output pixel centre in source texels
+    vec2 centre = (vec2(p) + 0.5) * float(factor);
+    vec4 sum = vec4(0.0);
+    float weights = 0.0;
+    for (int y = -2 * factor; y < 2 * factor; y++) {
+        int sy = int(centre.y) + y;
+        float wy = lanczos2((float(sy) + 0.5 - centre.y) / float(factor));
+        for (int x = -2 * factor; x < 2 * factor; x++) {
+            int sx = int(centre.x) + x;
+            float w = wy * lanczos2((float(sx) + 0.5 - centre.x) / float(factor));
+            sum += w * texelFetch(source, clamp(ivec2(sx, sy), ivec2(0), size - 1), 0);
+            weights += w;
+        }
+    }
+    fragColor = clamp(sum / weights, 0.0, 1.0);
+})";
+
+//Rotated grid offsets in source texels, no two share a row or column
+static const float JITTER[4][2] = {{0.125f, 0.375f}, {0.375f, -0.125f}, {-0.125f, -0.375f}, {-0.375f, 0.125f}};
+
+static bool allocate_target(Supersample& ss, int width, int height) {
+    ss.width = width;
+    ss.height = height;
+    ss.allocated = false;
+
+    GLint maxSize = 0;
+    glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+    if (width * ss.factor > maxSize || height * ss.factor > maxSize) {
+        std::cerr << "Supersampling " << width << "x" << height << " " << ss.factor
+                  << " times exceeds the maximum texture size " << maxSize << std::endl;
+        return false;
+    }
+
+    //Half float, so samples are filtered before they are quantised and values outside 0-1 aren't
+    //clipped until the filter has weighed them
+    glBindTexture(GL_TEXTURE_2D, ss.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, width * ss.factor, height * ss.factor, 0, GL_RGBA, GL_FLOAT, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glBindFramebuffer(GL_FRAMEBUFFER, ss.framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, ss.texture, 0);
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    if (!complete)
+        std::cerr << "Supersampling framebuffer is not complete" << std::endl;
+
+    ss.allocated = complete;
+    return complete;
+}
+
+int init_supersample(Supersample& ss, int factor, DownsampleFilter filter, bool jitter, int width, int height) {
+    if (factor < 2 || factor > 4) {
+        std::cerr << "Supersampling needs a factor of 2 to 4" << std::endl;
+        return -1;
+    }
+
+    ss.factor = factor;
+    ss.filter = filter;
+    ss.jitter = jitter;
+
+    ss.program = create_program(downsampleFragmentSource);
+    if (!ss.program)
+        return -1;
+
+    glUseProgram(ss.program);
+    glUniform1i(glGetUniformLocation(ss.program, "source"), 0);
+    glUniform1i(glGetUniformLocation(ss.program, "factor"), factor);
+    glUniform1i(glGetUniformLocation(ss.program, "lanczos"), filter == DOWNSAMPLE_LANCZOS);
+
+    glGenTextures(1, &ss.texture);
+    glGenFramebuffers(1, &ss.framebuffer);
+    if (!allocate_target(ss, width, height)) {
+        destroy_supersample(ss);
+        return -1;
+    }
+    return 0;
+}
+
+bool begin_supersample(Supersample& ss, GLuint program, const FrameState& state, FrameState& scaled) {
+    int width = static_cast<int>(state.width);
+    int height = static_cast<int>(state.height);
+    if (width != ss.width || height != ss.height)
+        allocate_target(ss, width, height);
+
+    scaled = state;
+    if (!ss.allocated)
+        return false;
+
+    //Looked up every frame, the program may have been hot reloaded
+    if (ss.jitter) {
+        const float* offset = JITTER[ss.frame % 4];
+        glUniform2f(glGetUniformLocation(program, "shadedJitter"), offset[0], offset[1]);
+    }
+    ss.frame++;
+
+    scaled.width = static_cast<float>(ss.width * ss.factor);
+    scaled.height = static_cast<float>(ss.height * ss.factor);
+    scaled.mouseX = state.mouseX * ss.factor;
+    scaled.mouseY = state.mouseY * ss.factor;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, ss.framebuffer);
+    glViewport(0, 0, ss.width * ss.factor, ss.height * ss.factor);
+    return true;
+}
+
+void resolve_supersample(Supersample& ss, GLuint VAO) {
+    glUseProgram(ss.program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, ss.texture);
+    glBindVertexArray(VAO);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+}
+
+void destroy_supersample(Supersample& ss) {
+    if (ss.program)
+        glDeleteProgram(ss.program);
+    if (ss.framebuffer)
+        glDeleteFramebuffers(1, &ss.framebuffer);
+    if (ss.texture)
+        glDeleteTextures(1, &ss.texture);
+
+    ss = Supersample();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <glad/glad.h>
+
+#include "uniforms.h"
+
+//Inserted into the image shader (see insert_after_version) when jittering: offsets
+//gl_FragCoord by this frame's subpixel position of the rotated grid
+extern const char* supersampleJitterPrelude;
+
+enum DownsampleFilter {
+    DOWNSAMPLE_BOX,    //Mean of the k x k samples of each pixel
+    DOWNSAMPLE_LANCZOS //Lanczos-2, sharper but with ringing at hard edges
+};
+
+//Supersampling of the image pass: the shader renders at `factor` times the output size in each
+//direction, then a filter pass reduces it to the output. With jitter, every frame also shifts the
+//sample grid by one of 4 rotated-grid offsets, so combined with --accumulate each pixel converges
+//to 4 * factor^2 well spread samples
+struct Supersample {
+    int factor = 1;
+    DownsampleFilter filter = DOWNSAMPLE_BOX;
+    bool jitter = false;
+    unsigned long frame = 0;
+
+    GLuint framebuffer = 0;
+    GLuint texture = 0;
+    int width = 0; //Output size, the target is factor times larger
+    int height = 0;
+    bool allocated = false; //False after a resize the target couldn't follow, until the next one
+
+    GLuint program = 0;
+};
+
+//`factor` 2-4
+int init_supersample(Supersample& ss, int factor, DownsampleFilter filter, bool jitter, int width, int height);
+
+//Bind the high resolution target. `scaled` gets `state` with iResolution and iMouse in its pixels.
+//Call with the image program in use, it gets this frame's jitter through the prelude's uniform.
+//Returns false, with `scaled` a copy of `state`, when the target couldn't be resized: render this
+//frame straight into the output and skip resolve_supersample
+bool begin_supersample(Supersample& ss, GLuint program, const FrameState& state, FrameState& scaled);
+
+//Filter down into the bound framebuffer and viewport with the quad in `VAO`.
+//Leaves the filter program bound and texture unit 0 changed
+void resolve_supersample(Supersample& ss, GLuint VAO);
+
+void destroy_supersample(Supersample& ss);
@@ -0,0 +1,309 @@
+#include "tune.h"
+#include "headless.h"
+#include "shader.h"
+#include "program_cache.h"
+#include "uniforms.h"
+#include "quality.h"
+#include "metrics.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+
+//One combination of knob values and how it did
+struct TuneVariant {
+    std::vector<int> values;
+    double gpuMs = 0.0; //Mean over the frames of the median draw
+    double cpuMs = 0.0; //Same, for draw + glFinish on the wall clock
+    double psnr = 0.0;  //Worst frame
+    double ssim = 0.0;  //Worst frame
+    double flip = 0.0;  //Worst frame
+    bool pareto = false;
+};
+
+//Offscreen target and quad every variant renders with
+struct TuneTarget {
+    int width = 0;
+    int height = 0;
+    GLuint framebuffer = 0;
+    GLuint texture = 0;
+    GLuint VAO = 0;
+    GLuint VBO = 0;
+    GLuint query = 0;
+};
+
+static int init_tune_target(TuneTarget& target, int width, int height) {
+    target.width = width;
+    target.height = height;
+
+    glGenTextures(1, &target.texture);
+    glBindTexture(GL_TEXTURE_2D, target.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &target.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target.texture, 0);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Tuning framebuffer is not complete" << std::endl;
+        return -1;
+    }
+    glViewport(0, 0, width, height);
+
+    float quadVerts[] = {
+       //Position       //UV
+       -1.0, -1.0,      0.0, 0.0,
+       -1.0,  1.0,      0.0, 1.0,
+        1.0, -1.0,      1.0, 0.0,
+
+        1.0, -1.0,      1.0, 0.0,
+       -1.0,  1.0,      0.0, 1.0,
+        1.0,  1.0,      1.0, 1.0
+    };
+    glGenVertexArrays(1, &target.VAO);
+    glBindVertexArray(target.VAO);
+    glGenBuffers(1, &target.VBO);
+    glBindBuffer(GL_ARRAY_BUFFER, target.VBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quadVerts), quadVerts, GL_STATIC_DRAW);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), reinterpret_cast<void*>(0));
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), reinterpret_cast<void*>(2 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+
+    glGenQueries(1, &target.query);
+    return 0;
+}
+
+static void destroy_tune_target(TuneTarget& target) {
+    glDeleteQueries(1, &target.query);
+    glDeleteBuffers(1, &target.VBO);
+    glDeleteVertexArrays(1, &target.VAO);
+    glDeleteFramebuffers(1, &target.framebuffer);
+    glDeleteTextures(1, &target.texture);
+    target = TuneTarget();
+}
+
+static double median(std::vector<double> values) {
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+//Render every frame of the options with `program`, reading the pixels of frame i into `frames[i]`
+static void render_variant(TuneTarget& target, GLuint program, const TuneOptions& options,
+                           std::vector<std::vector<unsigned char>>& frames, TuneVariant& variant) {
+    UniformTable uniforms;
+    reflect_uniforms(program, uniforms);
+    glUseProgram(program);
+    bind_channel_units(uniforms);
+
+    frames.resize(options.times.size());
+    variant.gpuMs = variant.cpuMs = 0.0;
+
+    for (size_t i = 0; i < options.times.size(); i++) {
+        FrameState state;
+        state.width = static_cast<float>(target.width);
+        state.height = static_cast<float>(target.height);
+        state.time = options.times[i];
+        state.timeDelta = 1.0f / 60.0f;
+        state.frame = i;
+        push_frame_uniforms(uniforms, state);
+
+        //The first draw of a program may compile it for real
+        glDrawArrays(GL_TRIANGLES, 0, 6);
+        glFinish();
+
+        std::vector<double> gpu, cpu;
+        for (int r = 0; r < options.repeat; r++) {
+            auto start = std::chrono::steady_clock::now();
+            glBeginQuery(GL_TIME_ELAPSED, target.query);
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+            glEndQuery(GL_TIME_ELAPSED);
+            glFinish();
+            cpu.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+            GLuint64 nanoseconds = 0;
+            glGetQueryObjectui64v(target.query, GL_QUERY_RESULT, &nanoseconds);
+            gpu.push_back(nanoseconds / 1e6);
+        }
+        variant.gpuMs += median(gpu) / options.times.size();
+        variant.cpuMs += median(cpu) / options.times.size();
+
+        frames[i].resize(static_cast<size_t>(target.width) * target.height * 4);
+        glReadPixels(0, 0, target.width, target.height, GL_RGBA, GL_UNSIGNED_BYTE, frames[i].data());
+    }
+}
+
+static ImageView frame_view(const std::vector<unsigned char>& pixels, const TuneOptions& options) {
+    ImageView view;
+    view.pixels = pixels.data();
+    view.width = options.width;
+    view.height = options.height;
+    return view;
+}
+
+//Values tried for a knob: `steps` of them evenly spread over lo..hi, fewer when the range is smaller
+static std::vector<int> knob_values(const QualityKnob& knob, int steps) {
+    std::vector<int> values;
+    for (int step = 0; step < steps; step++) {
+        int value = knob.lo + ((knob.hi - knob.lo) * step + (steps - 1) / 2) / (steps - 1);
+        if (values.empty() || values.back() != value)
+            values.push_back(value);
+    }
+    return values;
+}
+
+//Every combination of the knobs' values, the last knob changing fastest
+static std::vector<std::vector<int>> knob_lattice(const std::vector<QualityKnob>& knobs, int steps) {
+    std::vector<std::vector<int>> lattice(1);
+    for (const QualityKnob& knob : knobs) {
+        std::vector<std::vector<int>> extended;
+        for (const std::vector<int>& prefix : lattice) {
+            for (int value : knob_values(knob, steps)) {
+                extended.push_back(prefix);
+                extended.back().push_back(value);
+            }
+        }
+        lattice.swap(extended);
+    }
+    return lattice;
+}
+
+//Lower is better, in the metric the front is built on
+static double tune_error(const TuneVariant& variant, TuneMetric metric) {
+    return metric == TUNE_PSNR ? -variant.psnr : metric == TUNE_FLIP ? variant.flip : 1.0 - variant.ssim;
+}
+
+//Sort fastest first and flag every variant with less error than all faster ones
+static void mark_pareto_front(std::vector<TuneVariant>& variants, TuneMetric metric) {
+    std::sort(variants.begin(), variants.end(),
+              [metric](const TuneVariant& a, const TuneVariant& b) {
+                  return a.gpuMs != b.gpuMs ? a.gpuMs < b.gpuMs : tune_error(a, metric) < tune_error(b, metric);
+              });
+
+    bool first = true;
+    double best = 0.0;
+    for (TuneVariant& variant : variants) {
+        double error = tune_error(variant, metric);
+        variant.pareto = first || error < best;
+        if (variant.pareto)
+            best = error;
+        first = false;
+    }
+}
+
+static void write_tune_json(const TuneOptions& options, const std::vector<QualityKnob>& knobs,
+                            const std::vector<TuneVariant>& variants, std::ostream& out) {
+    out << "{\n"
+        << "  \"shader\": \"" << options.shaderPath << "\",\n"
+        << "  \"renderer\": \"" << glGetString(GL_RENDERER) << "\",\n"
+        << "  \"size\": [" << options.width << ", " << options.height << "],\n"
+        << "  \"times\": [";
+    for (size_t i = 0; i < options.times.size(); i++)
+        out << (i ? ", " : "") << options.times[i];
+    out << "],\n"
+        << "  \"metric\": \"" << (options.metric == TUNE_PSNR ? "psnr" : options.metric == TUNE_FLIP ? "flip" : "ssim") << "\",\n"
+        << "  \"unit\": \"ms\",\n"
+        << "  \"knobs\": [";
+    for (size_t i = 0; i < knobs.size(); i++) {
+        out << (i ? ", " : "") << "{\"name\": \"" << knobs[i].name << "\", \"lo\": " << knobs[i].lo
+            << ", \"hi\": " << knobs[i].hi << "}";
+    }
+    out << "],\n"
+        << "  \"variants\": [";
+    for (size_t v = 0; v < variants.size(); v++) {
+        const TuneVariant& variant = variants[v];
+        out << (v ? "," : "") << "\n    {\"values\": {";
+        for (size_t i = 0; i < knobs.size(); i++)
+            out << (i ? ", " : "") << "\"" << knobs[i].name << "\": " << variant.values[i];
+        out << "}, \"gpu_ms\": " << variant.gpuMs << ", \"cpu_ms\": " << variant.cpuMs
+            << ", \"psnr\": " << variant.psnr << ", \"ssim\": " << variant.ssim << ", \"flip\": " << variant.flip
+            << ", \"pareto\": " << (variant.pareto ? "true" : "false") << "}";
+    }
+    out << "\n  ]\n}" << std::endl;
+}
+
+int run_tune(const TuneOptions& options) {
+    std::string source;
+    if (read_file(options.shaderPath.c_str(), source))
+        return -1;
+
+    std::vector<QualityKnob> knobs = parse_quality_knobs(source);
+    if (knobs.empty()) {
+        std::cerr << "The shader has no // @quality NAME lo..hi knobs to tune" << std::endl;
+        return -1;
+    }
+
+    HeadlessContext headless;
+    TuneTarget target;
+    if (create_headless_context(headless, options.width, options.height)
+        || init_tune_target(target, options.width, options.height)) {
+        return -1;
+    }
+
+    //Every knob at its highest value renders the reference frames
+    std::vector<std::vector<int>> lattice = knob_lattice(knobs, options.steps);
+    std::vector<std::vector<unsigned char>> reference, frames;
+    std::vector<TuneVariant> variants;
+    int result = 0;
+
+    for (size_t v = lattice.size(); v-- > 0; ) {
+        TuneVariant variant;
+        variant.values = lattice[v];
+
+        std::string defines = quality_defines(knobs, variant.values);
+        GLuint program = create_cached_program(insert_after_version(source, defines).c_str());
+        if (!program) {
+            //Without the reference there is nothing to compare against
+            if (v == lattice.size() - 1) {
+                result = -1;
+                break;
+            }
+            continue;
+        }
+
+        bool isReference = reference.empty();
+        render_variant(target, program, options, isReference ? reference : frames, variant);
+        glDeleteProgram(program);
+
+        variant.psnr = PSNR_IDENTICAL;
+        variant.ssim = 1.0;
+        variant.flip = 0.0;
+        for (size_t i = 0; !isReference && i < frames.size(); i++) {
+            ImageMetrics metrics;
+            compare_images(frame_view(frames[i], options), frame_view(reference[i], options), metrics);
+            variant.psnr = std::min(variant.psnr, metrics.psnr);
+            variant.ssim = std::min(variant.ssim, metrics.ssim);
+            variant.flip = std::max(variant.flip, metrics.flip);
+        }
+        variants.push_back(variant);
+
+        std::cerr << "[" << variants.size() << "/" << lattice.size() << "]";
+        for (size_t i = 0; i < knobs.size(); i++)
+            std::cerr << " " << knobs[i].name << "=" << variant.values[i];
+        std::cerr << ": " << variant.gpuMs << " ms, PSNR " << variant.psnr << " dB, SSIM " << variant.ssim
+                  << ", FLIP " << variant.flip << std::endl;
+    }
+
+    if (!result) {
+        mark_pareto_front(variants, options.metric);
+
+        if (options.outputPath == "-") {
+            write_tune_json(options, knobs, variants, std::cout);
+        }
+        else {
+            std::ofstream out(options.outputPath);
+            if (!out) {
+                std::cerr << "Failed to open " << options.outputPath << " for writing" << std::endl;
+                result = -1;
+            }
+            else {
+                write_tune_json(options, knobs, variants, out);
+            }
+        }
+    }
+
+    destroy_tune_target(target);
+    destroy_headless_context(headless);
+    return result;
+}
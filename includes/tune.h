@@ -0,0 +1,11 @@
+#pragma once
+
+#include "options.h"
+
+//Offline search of a shader's @quality knobs (see quality.h). Frames at the highest value of every
+//knob are the reference; every combination of `steps` values per knob renders the same frames
+//headless, timed with GL_TIME_ELAPSED queries (median of `repeat` draws after an untimed one that
+//absorbs shader JIT), and is scored with compare_images against the reference. The JSON profile
+//lists every variant fastest first, flagging those no faster variant matches in the chosen metric:
+//the Pareto front of GPU time against error on this machine. Buffer passes and channels aren't bound
+int run_tune(const TuneOptions& options);
@@ -0,0 +1,80 @@
+#include "uniforms.h"
+
+#include <cstring>
+
+//Shader-side names of each input, in UniformInput order
+static const char* uniformNames[UNIFORM_COUNT] = {
+    "iResolution",
+    "iTime",
+    "iTimeDelta",
+    "iFrame",
+    "iMouse",
+    "iChannel0",
+    "iChannel1",
+    "iChannel2",
+    "iChannel3",
+    "iChannelTime",
+};
+
+void reflect_uniforms(GLuint program, UniformTable& table) {
+    table = UniformTable();
+
+    GLint count = 0;
+    glGetProgramiv(program, GL_ACTIVE_UNIFORMS, &count);
+
+    for (GLint i = 0; i < count; i++) {
+        char name[256];
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = GL_NONE;
+        glGetActiveUniform(program, i, sizeof(name), &length, &size, &type, name);
+
+        //Arrays are reported as "name[0]"
+        char* bracket = strchr(name, '[');
+        if (bracket)
+            *bracket = '\0';
+
+        for (int input = 0; input < UNIFORM_COUNT; input++) {
+            if (!strcmp(name, uniformNames[input])) {
+                table.bindings[input].location = glGetUniformLocation(program, name);
+                table.bindings[input].type = type;
+                break;
+            }
+        }
+    }
+}
+
+void set_uniform(const UniformTable& table, UniformInput input, float x, float y, float z, float w) {
+    const UniformBinding& binding = table.bindings[input];
+    if (binding.location < 0)
+        return;
+
+    switch (binding.type) {
+        case GL_FLOAT:      glUniform1f(binding.location, x); break;
+        case GL_FLOAT_VEC2: glUniform2f(binding.location, x, y); break;
+        case GL_FLOAT_VEC3: glUniform3f(binding.location, x, y, z); break;
+        case GL_FLOAT_VEC4: glUniform4f(binding.location, x, y, z, w); break;
+        case GL_INT:        glUniform1i(binding.location, static_cast<GLint>(x)); break;
+        case GL_INT_VEC2:   glUniform2i(binding.location, static_cast<GLint>(x), static_cast<GLint>(y)); break;
+        case GL_SAMPLER_2D: glUniform1i(binding.location, static_cast<GLint>(x)); break;
+        default: break;
+    }
+}
+
+void push_frame_uniforms(const UniformTable& table, const FrameState& state) {
+    set_uniform(table, UNIFORM_RESOLUTION, state.width, state.height, 1.0f);
+    set_uniform(table, UNIFORM_TIME, state.time);
+    set_uniform(table, UNIFORM_TIME_DELTA, state.timeDelta);
+    set_uniform(table, UNIFORM_FRAME, static_cast<float>(state.frame));
+    set_uniform(table, UNIFORM_MOUSE, state.mouseX, state.mouseY);
+
+    //float iChannelTime[4], the only array input
+    const UniformBinding& channelTime = table.bindings[UNIFORM_CHANNEL_TIME];
+    if (channelTime.location >= 0 && channelTime.type == GL_FLOAT)
+        glUniform1fv(channelTime.location, CHANNEL_COUNT, state.channelTime);
+}
+
+void bind_channel_units(const UniformTable& table) {
+    for (int channel = 0; channel < CHANNEL_COUNT; channel++)
+        set_uniform(table, static_cast<UniformInput>(UNIFORM_CHANNEL0 + channel), static_cast<float>(channel));
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <glad/glad.h>
+
+//Shadertoy inputs ShadeD knows how to feed
+enum UniformInput {
+    UNIFORM_RESOLUTION,
+    UNIFORM_TIME,
+    UNIFORM_TIME_DELTA,
+    UNIFORM_FRAME,
+    UNIFORM_MOUSE,
+    UNIFORM_CHANNEL0,
+    UNIFORM_CHANNEL1,
+    UNIFORM_CHANNEL2,
+    UNIFORM_CHANNEL3,
+    UNIFORM_CHANNEL_TIME,
+    UNIFORM_COUNT
+};
+
+//Where and how a linked program declares one input, location is -1 if it doesn't
+struct UniformBinding {
+    GLint location = -1;
+    GLenum type = GL_NONE;
+};
+
+//Number of iChannel samplers
+const int CHANNEL_COUNT = 4;
+
+//Binding table built once per linked program
+struct UniformTable {
+    UniformBinding bindings[UNIFORM_COUNT];
+};
+
+//Reflect the active uniforms of a linked program with glGetActiveUniform and fill the table
+void reflect_uniforms(GLuint program, UniformTable& table);
+
+//Push a value to the currently used program, converted to the declared type
+//(e.g. iResolution as vec2 or vec3, iMouse as vec2 or vec4). Undeclared inputs are skipped
+void set_uniform(const UniformTable& table, UniformInput input, float x, float y = 0.0f, float z = 0.0f, float w = 0.0f);
+
+//Per-frame values of the inputs, shared by every pass of a frame
+struct FrameState {
+    float width = 0.0f;
+    float height = 0.0f;
+    float time = 0.0f;
+    float timeDelta = 0.0f;
+    unsigned long frame = 0;
+    float mouseX = 0.0f;
+    float mouseY = 0.0f;
+    float channelTime[CHANNEL_COUNT] = {0.0f, 0.0f, 0.0f, 0.0f}; //Playback position of time based inputs
+};
+
+//Push resolution, time, frame, mouse and channel times from the state to the currently used program
+void push_frame_uniforms(const UniformTable& table, const FrameState& state);
+
+//Point iChannel0..3 at texture units 0..3 of the currently used program
+void bind_channel_units(const UniformTable& table);
+
+//Whether the shader actually uses an input
+inline bool has_uniform(const UniformTable& table, UniformInput input) {
+    return table.bindings[input].location >= 0;
+}
@@ -0,0 +1,199 @@
+#include "video_sink.h"
+
+#include <iostream>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <climits>
+#include <cmath>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+int parse_video_format(const char* name, VideoFormat& format) {
+    if (!strcmp(name, "y4m"))
+        format = VIDEO_Y4M;
+    else if (!strcmp(name, "raw"))
+        format = VIDEO_RAW;
+    else
+        return -1;
+    return 0;
+}
+
+int open_video_sink(VideoSink& sink, const std::string& path, VideoFormat format, int width, int height, double fps) {
+    //A reader that exits should surface as EPIPE on write, not kill the process
+    signal(SIGPIPE, SIG_IGN);
+
+    if (path == "-") {
+        sink.fd = dup(STDOUT_FILENO);
+        dup2(STDERR_FILENO, STDOUT_FILENO);
+    }
+    else {
+        //Opening a named pipe blocks here until the encoder opens its end
+        sink.fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+
+    if (sink.fd < 0) {
+        std::cerr << "Failed to open video output " << path << ": " << strerror(errno) << std::endl;
+        return -1;
+    }
+
+#ifdef F_SETPIPE_SZ
+    //A bigger pipe means fewer wakeups per frame, this fails harmlessly on regular files
+    fcntl(sink.fd, F_SETPIPE_SZ, 1 << 20);
+#endif
+
+    sink.format = format;
+    sink.width = width;
+    sink.height = height;
+    sink.fps = fps;
+
+    if (format == VIDEO_RAW) {
+        std::cerr << "Raw video: ffmpeg -f rawvideo -pix_fmt rgba -s " << width << "x" << height
+                  << " -r " << fps << " -i -" << std::endl;
+    }
+
+    return 0;
+}
+
+//Write every iovec completely, retrying short writes. Blocks while the reader is behind
+static bool write_all(int fd, struct iovec* iov, int count) {
+    while (count > 0) {
+        ssize_t written = writev(fd, iov, count < IOV_MAX ? count : IOV_MAX);
+        if (written < 0) {
+            if (errno == EINTR)
+                continue;
+            std::cerr << "Video output write failed: " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        //Skip the fully written vectors and trim the partially written one
+        while (count > 0 && static_cast<size_t>(written) >= iov->iov_len) {
+            written -= iov->iov_len;
+            iov++;
+            count--;
+        }
+        if (count > 0) {
+            iov->iov_base = static_cast<char*>(iov->iov_base) + written;
+            iov->iov_len -= written;
+        }
+    }
+    return true;
+}
+
+//BT.601 limited range, chroma averaged over 2x2 blocks (C420jpeg siting). Flips to top-down
+static void rgba_to_yuv420(const unsigned char* pixels, int width, int height, unsigned char* planes) {
+    int chromaWidth = (width + 1) / 2;
+    int chromaHeight = (height + 1) / 2;
+
+    unsigned char* yPlane = planes;
+    unsigned char* uPlane = yPlane + static_cast<size_t>(width) * height;
+    unsigned char* vPlane = uPlane + static_cast<size_t>(chromaWidth) * chromaHeight;
+
+    for (int y = 0; y < height; y++) {
+        const unsigned char* src = pixels + static_cast<size_t>(height - 1 - y) * width * 4;
+        unsigned char* dst = yPlane + static_cast<size_t>(y) * width;
+        for (int x = 0; x < width; x++) {
+            int r = src[x * 4], g = src[x * 4 + 1], b = src[x * 4 + 2];
+            dst[x] = static_cast<unsigned char>(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+        }
+    }
+
+    for (int cy = 0; cy < chromaHeight; cy++) {
+        int y0 = cy * 2;
+        int y1 = y0 + 1 < height ? y0 + 1 : y0;
+        const unsigned char* row0 = pixels + static_cast<size_t>(height - 1 - y0) * width * 4;
+        const unsigned char* row1 = pixels + static_cast<size_t>(height - 1 - y1) * width * 4;
+
+        for (int cx = 0; cx < chromaWidth; cx++) {
+            int x0 = cx * 2;
+            int x1 = x0 + 1 < width ? x0 + 1 : x0;
+
+            int r = row0[x0 * 4]     + row0[x1 * 4]     + row1[x0 * 4]     + row1[x1 * 4];
+            int g = row0[x0 * 4 + 1] + row0[x1 * 4 + 1] + row1[x0 * 4 + 1] + row1[x1 * 4 + 1];
+            int b = row0[x0 * 4 + 2] + row0[x1 * 4 + 2] + row1[x0 * 4 + 2] + row1[x1 * 4 + 2];
+            r = (r + 2) >> 2;
+            g = (g + 2) >> 2;
+            b = (b + 2) >> 2;
+
+            size_t i = static_cast<size_t>(cy) * chromaWidth + cx;
+            uPlane[i] = static_cast<unsigned char>(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+            vPlane[i] = static_cast<unsigned char>(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+        }
+    }
+}
+
+void write_video_frame(const unsigned char* pixels, int width, int height, void* userData) {
+    VideoSink* sink = static_cast<VideoSink*>(userData);
+    if (sink->failed)
+        return;
+
+    if (width != sink->width || height != sink->height) {
+        std::cerr << "Video output expects " << sink->width << "x" << sink->height << " frames" << std::endl;
+        sink->failed = true;
+        return;
+    }
+
+    if (sink->format == VIDEO_RAW) {
+        //One vector per row in reverse order flips the image without copying it
+        std::vector<struct iovec> rows(height);
+        size_t stride = static_cast<size_t>(width) * 4;
+        for (int y = 0; y < height; y++) {
+            rows[y].iov_base = const_cast<unsigned char*>(pixels + (height - 1 - y) * stride);
+            rows[y].iov_len = stride;
+        }
+
+        sink->failed = !write_all(sink->fd, rows.data(), height);
+    }
+    else {
+        char header[128];
+        int headerLength = 0;
+        if (!sink->headerWritten) {
+            //Frame rate as a ratio, exact for integer rates and good to 1/1000 otherwise
+            long rateNum = lround(sink->fps * 1000.0);
+            long rateDen = 1000;
+            if (rateNum % 1000 == 0) {
+                rateNum /= 1000;
+                rateDen = 1;
+            }
+            headerLength = snprintf(header, sizeof(header), "YUV4MPEG2 W%d H%d F%ld:%ld Ip A1:1 C420jpeg\n",
+                                    width, height, rateNum, rateDen);
+            sink->headerWritten = true;
+        }
+        headerLength += snprintf(header + headerLength, sizeof(header) - headerLength, "FRAME\n");
+
+        size_t lumaBytes = static_cast<size_t>(width) * height;
+        size_t chromaBytes = static_cast<size_t>((width + 1) / 2) * ((height + 1) / 2);
+        size_t frameBytes = lumaBytes + chromaBytes * 2;
+
+        //Planes converted on the GPU go out straight from the mapped PBO
+        const unsigned char* planes = pixels;
+        if (!sink->planar) {
+            sink->planes.resize(frameBytes);
+            rgba_to_yuv420(pixels, width, height, sink->planes.data());
+            planes = sink->planes.data();
+        }
+
+        struct iovec iov[2];
+        iov[0].iov_base = header;
+        iov[0].iov_len = headerLength;
+        iov[1].iov_base = const_cast<unsigned char*>(planes);
+        iov[1].iov_len = frameBytes;
+
+        sink->failed = !write_all(sink->fd, iov, 2);
+    }
+
+    if (!sink->failed)
+        sink->frames++;
+}
+
+void close_video_sink(VideoSink& sink) {
+    if (sink.fd >= 0)
+        close(sink.fd);
+    sink.fd = -1;
+}
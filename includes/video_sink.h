@@ -0,0 +1,40 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+//Container written by the video sink
+enum VideoFormat {
+    VIDEO_Y4M, //YUV4MPEG2, planar 4:2:0 BT.601, self-describing
+    VIDEO_RAW  //Headerless top-down RGBA frames (ffmpeg -f rawvideo -pix_fmt rgba)
+};
+
+//Streams captured frames to stdout, a named pipe or a file for `ffmpeg -i -` style encoding.
+//Writes are blocking, so a slow reader stalls the render loop instead of frames being dropped
+struct VideoSink {
+    int fd = -1;
+    VideoFormat format = VIDEO_Y4M;
+    int width = 0;
+    int height = 0;
+    double fps = 60.0;
+
+    bool planar = false; //Y4M frames arrive already converted to I420 (see YuvPass)
+
+    bool headerWritten = false;
+    bool failed = false; //Set once the reader goes away, the render loop should stop
+
+    unsigned long frames = 0;
+    std::vector<unsigned char> planes; //Converted Y4M frame
+};
+
+//Parse "y4m" or "raw", returns -1 when unknown
+int parse_video_format(const char* name, VideoFormat& format);
+
+//Open "-" (stdout) or a path. When writing to stdout, fd 1 is pointed at stderr afterwards
+//so log output can't end up in the video stream
+int open_video_sink(VideoSink& sink, const std::string& path, VideoFormat format, int width, int height, double fps);
+
+//FrameConsumer for the capture ring, userData is a VideoSink
+void write_video_frame(const unsigned char* pixels, int width, int height, void* userData);
+
+void close_video_sink(VideoSink& sink);
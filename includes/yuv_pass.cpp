@@ -0,0 +1,100 @@
+#include "yuv_pass.h"
+#include "shader.h"
+
+#include <iostream>
+
+//Same BT.601 limited range coefficients as the CPU path in video_sink.cpp
+static const char* yuvFragmentSource =
+R"(#version 330 core
+uniform sampler2D source;
+uniform ivec2 size;
+out float plane;
+
+const vec3 lumaWeights = vec3( 0.2568,  0.5041,  0.0979);
+const vec3 uWeights    = vec3(-0.1482, -0.2910,  0.4392);
+const vec3 vWeights    = vec3( 0.4392, -0.3678, -0.0714);
+
+vec3 fetch(int x, int topDownY) {
+    return texelFetch(source, ivec2(x, size.y - 1 - topDownY), 0).rgb;
+}
+
+void main() {
+    ivec2 p = ivec2(gl_FragCoord.xy);
+
+    if (p.y < size.y) {
+        plane = dot(fetch(p.x, p.y), lumaWeights) + 16.0 / 255.0;
+        return;
+    }
+
+    //Chroma rows: U on the left half, V on the right, each averaged over a 2x2 block
+    int halfWidth = size.x / 2;
+    bool isV = p.x >= halfWidth;
+    int cx = (isV ? p.x - halfWidth : p.x) * 2;
+    int cy = (p.y - size.y) * 2;
+
+    vec3 c = (fetch(cx, cy) + fetch(cx + 1, cy) + fetch(cx, cy + 1) + fetch(cx + 1, cy + 1)) * 0.25;
+    plane = dot(c, isV ? vWeights : uWeights) + 128.0 / 255.0;
+})";
+
+int init_yuv_pass(YuvPass& pass, int width, int height) {
+    if (width % 2 || height % 2) {
+        std::cerr << "GPU YUV conversion needs an even width and height" << std::endl;
+        return -1;
+    }
+
+    pass.width = width;
+    pass.height = height;
+
+    pass.program = create_program(yuvFragmentSource);
+    if (!pass.program)
+        return -1;
+
+    glUseProgram(pass.program);
+    glUniform1i(glGetUniformLocation(pass.program, "source"), 0);
+    glUniform2i(glGetUniformLocation(pass.program, "size"), width, height);
+
+    glGenTextures(1, &pass.texture);
+    glBindTexture(GL_TEXTURE_2D, pass.texture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, width, height * 3 / 2, 0, GL_RED, GL_UNSIGNED_BYTE, 0);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenFramebuffers(1, &pass.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+    glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pass.texture, 0);
+
+    bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+    if (!complete) {
+        std::cerr << "YUV framebuffer is not complete" << std::endl;
+        destroy_yuv_pass(pass);
+        return -1;
+    }
+
+    return 0;
+}
+
+void render_yuv_pass(YuvPass& pass, GLuint sourceTexture, GLuint VAO) {
+    glBindFramebuffer(GL_FRAMEBUFFER, pass.framebuffer);
+    glViewport(0, 0, pass.width, pass.height * 3 / 2);
+
+    glUseProgram(pass.program);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, sourceTexture);
+
+    glBindVertexArray(VAO);
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+}
+
+void destroy_yuv_pass(YuvPass& pass) {
+    if (pass.program)
+        glDeleteProgram(pass.program);
+    if (pass.framebuffer)
+        glDeleteFramebuffers(1, &pass.framebuffer);
+    if (pass.texture)
+        glDeleteTextures(1, &pass.texture);
+
+    pass = YuvPass();
+}
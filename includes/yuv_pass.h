@@ -0,0 +1,24 @@
+#pragma once
+
+#include <glad/glad.h>
+
+//Fullscreen pass converting a rendered RGBA frame to BT.601 4:2:0 on the GPU, so only
+//1.5 bytes per pixel have to be read back. The R8 target is width x (height * 3 / 2):
+//luma in the first `height` rows, then each remaining row holds a U row and a V row side by side.
+//Rows are written top-down so the planes read back in the order video expects
+struct YuvPass {
+    GLuint program = 0;
+    GLuint framebuffer = 0;
+    GLuint texture = 0;
+    int width = 0;
+    int height = 0;
+};
+
+//Needs an even width and height
+int init_yuv_pass(YuvPass& pass, int width, int height);
+
+//Convert `sourceTexture` into the pass target using the quad in `VAO`.
+//Leaves the pass program bound and the viewport at the target size
+void render_yuv_pass(YuvPass& pass, GLuint sourceTexture, GLuint VAO);
+
+void destroy_yuv_pass(YuvPass& pass);
@@ -4,66 +4,118 @@
 #include <glm/glm.hpp>
 #include <fstream>
 #include <sstream>
-#include <portaudio.h>
-
-// Error checking macro
-#define PA_CHECK(err) if (err != paNoError) { \
-    std::cerr << "PortAudio error: " << Pa_GetErrorText(err) << std::endl; \
-    exit(1); \
-}
-
-//Global audio data for portaudio just for now
-float audioData[512] = {0}; //Buffer for FFT/audio texture
-PaStream* audioStream;
-
-// Audio callback (stereo sine wave)
-static int audioCallback(
-    const void* input, void* output,
-    unsigned long frameCount,
-    const PaStreamCallbackTimeInfo* timeInfo,
-    PaStreamCallbackFlags statusFlags,
-    void* userData
-) {
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <cstdlib>
+
+#include "includes/options.h"
+#include "includes/headless.h"
+#include "includes/shader.h"
+#include "includes/uniforms.h"
+#include "includes/capture.h"
+#include "includes/video_sink.h"
+#include "includes/yuv_pass.h"
+#include "includes/benchmark.h"
+#include "includes/passes.h"
+#include "includes/accumulate.h"
+#include "includes/program_cache.h"
+#include "includes/hot_reload.h"
+#include "includes/audio_analysis.h"
+#include "includes/audio_texture.h"
+#include "includes/audio_player.h"
+#include "includes/sound_shader.h"
+#include "includes/audio_backend.h"
+#include "includes/dynamic_resolution.h"
+#include "includes/interleave.h"
+#include "includes/supersample.h"
+#include "includes/foveate.h"
+#include "includes/quality.h"
+#include "includes/tune.h"
+#include "includes/compare.h"
+
+//Global audio state, shared with the audio callback
+AudioAnalysis audioAnalysis; //Hands the callback's samples to the render thread without locking
+AudioPlayer audioPlayer;     //Streams --audio-file, decoding ahead on its own thread
+bool playingFile = false;
+SoundShader soundShader;     //--sound, rendered ahead on the GPU by the render loop
+bool playingSound = false;
+AudioBackend audioBackend;   //PortAudio, or a timer for machines without a sound card
+
+//Output rate unless an audio file brings its own
+const int SAMPLE_RATE = 44100;
+
+// Audio callback (audio file, sound shader, or a stereo sine wave)
+static void audioCallback(float* output, unsigned long frameCount, double dacTime, void* userData) {
     static float phase         = 0.0f;
     const float freq           = 440.0f;
     const float sampleRate     = 44100.0f;
     const float phaseIncrement = freq * 2.0f * 3.14159f / sampleRate;
 
-    float* out = (float*)output;
+    float* out = output;
+    AudioAnalysis* analysis = static_cast<AudioAnalysis*>(userData);
+
+    //The prefetch thread or the GPU already produced the samples, this is only a copy
+    if (playingFile) {
+        play_audio_frames(audioPlayer, out, frameCount, dacTime);
+    }
+    else if (playingSound) {
+        play_sound_frames(soundShader, out, frameCount);
+    }
 
-    for (int i = 0; i < frameCount; i++) {
-        float sample = 0.1f * sin(phase); //Scale to [-0.1, 0.1] for safety
-        out[i * 2] = sample;              //Left channel
-        out[i * 2 + 1] = sample;          //Right channel
-        phase += phaseIncrement;
+    //Mono copy for the analysis stage, pushed in chunks to keep atomics out of the sample loop
+    float mono[256];
+    int pending = 0;
 
-        if (phase > 2.0f * 3.14159f) phase -= 2.0f * 3.14159f;
+    for (unsigned long i = 0; i < frameCount; i++) {
+        float sample;
+        if (playingFile || playingSound) {
+            sample = 0.5f * (out[i * 2] + out[i * 2 + 1]);
+        }
+        else {
+            sample = 0.1f * sin(phase); //Scale to [-0.1, 0.1] for safety
+            out[i * 2] = sample;        //Left channel
+            out[i * 2 + 1] = sample;    //Right channel
+            phase += phaseIncrement;
+
+            if (phase > 2.0f * 3.14159f) phase -= 2.0f * 3.14159f;
+        }
+
+        mono[pending++] = sample;
+        if (pending == 256) {
+            push_audio_samples(*analysis, mono, pending);
+            pending = 0;
+        }
+    }
+    push_audio_samples(*analysis, mono, pending);
+}
 
-        audioData[i % 512] = sample; //Update texture data
+//Start the audio backend (stereo, 32-bit float), playing `audioFile` when set
+void init_audio(const std::string& audioFile) {
+    int sampleRate = SAMPLE_RATE;
+    if (!audioFile.empty()) {
+        if (start_audio_player(audioPlayer, audioFile)) {
+            exit(-1);
+        }
+        playingFile = true;
+        sampleRate = audioPlayer.file.sampleRate;
     }
 
-    return paContinue;
+    start_audio_analysis(audioAnalysis);
+
+    //At the file's rate, no resampling
+    if (start_audio_backend(audioBackend, sampleRate, audioCallback, &audioAnalysis)) {
+        exit(-1);
+    }
 }
 
-//Initialize PortAudio (stereo, 32-bit float)
-void init_audio() {
-    PaError err = Pa_Initialize();
-    PA_CHECK(err);
-
-    err = Pa_OpenDefaultStream(
-        &audioStream,
-        0,          //No input
-        2,          //Stereo output
-        paFloat32,  //32-bit float (matches OpenAL scaling)
-        44100,      //Sample rate
-        512,        //Larger buffer to reduce glitches
-        audioCallback,
-        nullptr
-    );
-    PA_CHECK(err);
-
-    err = Pa_StartStream(audioStream);
-    PA_CHECK(err);
+//Stop the audio threads, the callback first as it reads from the others. Registered with atexit,
+//as every exit(-1) of a failed setup step would otherwise destroy the globals above with their
+//std::threads still joinable, which aborts
+void stop_audio() {
+    stop_audio_backend(audioBackend);
+    stop_audio_analysis(audioAnalysis);
+    stop_audio_player(audioPlayer);
 }
 
 //Framebuffer resize
@@ -72,77 +124,145 @@ void framebuffer_size_callback(GLFWwindow* window, int width, int height);
 //Mouse movement (iMouse)
 void mouse_callback(GLFWwindow* window, double xpos, double ypos);
 
-//Method to read file
-int read_file(const char* filePath, std::string& fileString);
-
-//For obtaining any errors from the shader program
-void checkCompileErrors(unsigned int shader, std::string type);
-
 //Main fragment shader ID
 GLuint shaderProgram;
 
-//Vertex shader of the rendering quad
-const char *vertexShaderSource =
-R"(#version 330 core
-layout (location = 0) in vec2 position;
-layout (location = 1) in vec2 inTexCoord;
+//Shadertoy inputs the main shader declares, reflected once after linking
+UniformTable uniforms;
 
-out vec2 texCoord;
-void main(){
-    texCoord = inTexCoord;
-    gl_Position = vec4(position.x, position.y, 0.0f, 1.0f);
-})";
+//Resolution, time and mouse of the frame being rendered, the callbacks update it
+FrameState frameState;
 
-int main(int argc, char** argv) {
-    int width = 200;
-    int height = 200;
+//Set by SIGINT/SIGTERM, headless runs have no window to close
+volatile sig_atomic_t quitRequested = 0;
 
-    glm::vec2 screen(width, height);
+void signal_handler(int) {
+    quitRequested = 1;
+}
 
-    float deltaTime = 0.0f;
-    float lastFrame = 0.0f;
+//Shared contexts for the shader reload thread, userData is the HeadlessContext or GLFWwindow
+static bool headless_worker_context(bool current, void* userData) {
+    return make_headless_current(*static_cast<HeadlessContext*>(userData), current);
+}
+
+static bool window_worker_context(bool current, void* userData) {
+    glfwMakeContextCurrent(current ? static_cast<GLFWwindow*>(userData) : nullptr);
+    return true;
+}
+
+//Seconds since startup, works with or without GLFW initialized
+double get_time() {
+    static const auto start = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+
+int main(int argc, char** argv) {
+    //Offline search of the shader's quality knobs, a run of its own
+    if (argc > 1 && !strcmp(argv[1], "tune")) {
+        TuneOptions tuneOptions;
+        if (parse_tune_options(argc, argv, tuneOptions)) {
+            print_tune_usage(argv[0]);
+            return -1;
+        }
+        return run_tune(tuneOptions);
+    }
+
+    //Image comparison, no rendering involved
+    if (argc > 1 && !strcmp(argv[1], "compare")) {
+        CompareOptions compareOptions;
+        if (parse_compare_options(argc, argv, compareOptions)) {
+            print_compare_usage(argv[0]);
+            return -1;
+        }
+        return run_compare(compareOptions);
+    }
 
     //Check if necessary arguments are passed in
-    if (argc < 2) {
-      std::cout << "Usage: " << argv[0] << " <glsl-fragment-shader>" << std::endl;
+    Options options;
+    if (parse_options(argc, argv, options)) {
+      print_usage(argv[0]);
       return -1;
     }
 
+    int width = options.width;
+    int height = options.height;
+
+    //Captured frames keep the requested size, so they are always rendered offscreen
+    bool capturing = !options.outputPath.empty() || !options.dumpPrefix.empty() || !options.comparePrefix.empty();
+
+    frameState.width = width;
+    frameState.height = height;
+
+    float deltaTime = 0.0f;
+    float lastFrame = options.startTime;
+
+    //Offline runs advance a synthetic clock by exactly 1/fps per frame, however long a frame takes
+    bool fixedTimestep = options.fps > 0.0;
+
+    //PortAudio enumerates devices while the GL context is created
+    atexit(stop_audio);
+    prepare_audio_backend(audioBackend, options.audioBackend, options.audioWavPath);
+
     //First get fragment shader code from file
     std::string fragmentShaderCode;
-    if (read_file(argv[1], fragmentShaderCode)) {
+    if (read_file(options.shaderPath.c_str(), fragmentShaderCode)) {
       return -1;
     }
+    //Interleaved rendering moves gl_FragCoord of the image pass onto this frame's pixels,
+    //and supersampling with jitter offsets it within the pixel
+    std::string imagePrelude = options.interleave ? interleavePrelude
+                             : options.supersampleJitter ? supersampleJitterPrelude : "";
+    std::string imageCode = imagePrelude.empty() ? fragmentShaderCode
+                                                 : insert_after_version(fragmentShaderCode, imagePrelude);
     //Obtain the fragment shader code to be passed in the shader compilation
-    const char* fragCode = fragmentShaderCode.c_str();
-
-    //Initialize GLFW window context
-    glfwInit();
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
-    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
-    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
-    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
-
-    GLFWwindow* window = glfwCreateWindow(width, height, "ShadeD", nullptr, nullptr);
-    if (!window) {
-        std::cerr << "failed to create window" << std::endl;
-        exit(-1);
-    }
+    const char* fragCode = imageCode.c_str();
 
-    glfwMakeContextCurrent(window);
-    glfwSetFramebufferSizeCallback(window, framebuffer_size_callback); //Resize window event
-    glfwSetCursorPosCallback(window, mouse_callback); //Cursor position event
+    GLFWwindow* window = nullptr;
+    HeadlessContext headless;
 
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
-        std::cerr << "Failed to initialize glad with processes " << std::endl;
-        exit(-1);
+    if (options.headless) {
+        //No display, render into the framebuffer object through EGL
+        if (create_headless_context(headless, width, height)) {
+            exit(-1);
+        }
+
+        signal(SIGINT, signal_handler);
+        signal(SIGTERM, signal_handler);
     }
+    else {
+        //Initialize GLFW window context
+        glfwInit();
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+        glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 3);
+        glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+        glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+        glfwWindowHint(GLFW_RESIZABLE, capturing ? GLFW_FALSE : GLFW_TRUE);
+
+        window = glfwCreateWindow(width, height, "ShadeD", nullptr, nullptr);
+        if (!window) {
+            std::cerr << "failed to create window" << std::endl;
+            exit(-1);
+        }
 
-    glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+        glfwMakeContextCurrent(window);
+        glfwSetFramebufferSizeCallback(window, framebuffer_size_callback); //Resize window event
+        glfwSetCursorPosCallback(window, mouse_callback); //Cursor position event
 
-    init_audio();
+        if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress)) {
+            std::cerr << "Failed to initialize glad with processes " << std::endl;
+            exit(-1);
+        }
+
+        glfwSetInputMode(window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+        //Fixed timestep renders as fast as possible, never wait for the display
+        if (fixedTimestep) {
+            glfwSwapInterval(0);
+        }
+
+    }
 
-    int samples = 4;
     float quadVerts[] = {
        //Position       //UV
        -1.0, -1.0,      0.0, 0.0,
@@ -182,137 +302,495 @@ int main(int argc, char** argv) {
     GLuint texColor;
     glGenTextures(1, &texColor);
     glBindTexture(GL_TEXTURE_2D, texColor);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, 0);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    //No mipmaps, the texture would be incomplete for sampling in later passes otherwise
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
     glBindTexture(GL_TEXTURE_2D, 0);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, texColor, 0);
 
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        std::cerr << "Framebuffer is not complete" << std::endl;
+        exit(-1);
+    }
+
     glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-    //Vertex shader
-    GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertexShader, 1, &vertexShaderSource, NULL);
-    glCompileShader(vertexShader);
-
-    //Fragment shader
-    GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragmentShader, 1, &fragCode, NULL);
-    glCompileShader(fragmentShader);
-    //Check for shader compile errors
-    checkCompileErrors(fragmentShader, "FRAGMENT");
-
-    //Link shaders
-    shaderProgram = glCreateProgram();
-    glAttachShader(shaderProgram, vertexShader);
-    glAttachShader(shaderProgram, fragmentShader);
-    glLinkProgram(shaderProgram);
-    //Check for program linking errors
-    //checkCompileErrors(shaderProgram, "PROGRAM");
+    //Headless has no default framebuffer, so the shader renders straight into the FBO.
+    //Captures do too and get blitted to the window afterwards
+    GLuint targetFramebuffer = (options.headless || capturing) ? framebuffer : 0;
+    glViewport(0, 0, width, height);
 
-    //Remove/deallocate shaders
-    glDeleteShader(vertexShader);
-    glDeleteShader(fragmentShader);
+    //Hot reloads and quality variants compile in the background. Without parallel compile,
+    //a thread compiles on a context sharing our objects
+    AsyncCompiler compiler;
+    HeadlessContext compileContext;
+    GLFWwindow* compileWindow = nullptr;
+    if (options.watch || options.quality > 0.0) {
+        WorkerContextFn workerContext = nullptr;
+        void* workerData = nullptr;
+        if (!has_parallel_shader_compile()) {
+            if (options.headless && !create_shared_headless_context(headless, compileContext)) {
+                workerContext = headless_worker_context;
+                workerData = &compileContext;
+            }
+            else if (window) {
+                glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+                compileWindow = glfwCreateWindow(1, 1, "", nullptr, window);
+                if (compileWindow) {
+                    workerContext = window_worker_context;
+                    workerData = compileWindow;
+                }
+            }
+        }
+        init_async_compiler(compiler, workerContext, workerData);
+    }
+
+    //Compile the fragment shader against the quad vertex shader, or load it from the binary cache
+    if (!options.programCache) {
+        disable_program_cache();
+    }
+
+    //With quality control the shader starts at its highest quality level, the others compile meanwhile
+    QualityController quality;
+    if (options.quality > 0.0) {
+        if (init_quality_controller(quality, fragmentShaderCode, imagePrelude, options.quality, compiler, shaderProgram)) {
+            exit(-1);
+        }
+    }
+    else {
+        shaderProgram = create_cached_program(fragCode);
+        if (!shaderProgram) {
+            exit(-1);
+        }
+    }
+
+    reflect_uniforms(shaderProgram, uniforms);
 
     glUseProgram(shaderProgram);
-    glUniform2fv(glGetUniformLocation(shaderProgram, "iResolution"), 1, &screen[0]);
+    bind_channel_units(uniforms);
+
+    //Buffer passes, each feeding iChannel<N> of the passes after it and of itself next frame
+    PassChain passChain;
+    bool multipass = false;
+    for (int channel = 0; channel < CHANNEL_COUNT; channel++) {
+        if (options.bufferPaths[channel].empty())
+            continue;
+
+        std::string bufferCode;
+        if (read_file(options.bufferPaths[channel].c_str(), bufferCode)
+            || init_buffer_pass(passChain, channel, bufferCode.c_str(), width, height)) {
+            exit(-1);
+        }
+        multipass = true;
+    }
 
+    //Spectrum and waveform of the playing audio, sampled like Shadertoy's audio input
+    AudioTexture audioTexture;
+    if (options.audioChannel >= 0) {
+        if (init_audio_texture(audioTexture)) {
+            exit(-1);
+        }
+        passChain.inputs[options.audioChannel] = audioTexture.texture;
+    }
 
-    while (!glfwWindowShouldClose(window)) {
+    //mainSound renders seconds ahead on the GPU, the audio callback only copies the samples
+    if (!options.soundPath.empty()) {
+        std::string soundCode;
+        if (read_file(options.soundPath.c_str(), soundCode)
+            || init_sound_shader(soundShader, soundCode, SAMPLE_RATE, VAO)) {
+            exit(-1);
+        }
+        playingSound = true;
+    }
 
-        float currentFrame = glfwGetTime();
-        deltaTime = currentFrame - lastFrame;
-        lastFrame = currentFrame;
+    init_audio(options.audioFile);
+
+    //Frame capture reads back through a PBO ring so the render loop never waits on glReadPixels
+    FrameConsumer consumer = nullptr;
+    void* consumerData = nullptr;
+    CaptureLayout captureLayout = CAPTURE_RGBA;
+
+    VideoSink videoSink;
+    PpmDump ppmDump;
+    FrameComparison frameComparison;
+    YuvPass yuvPass;
+    if (!options.outputPath.empty()) {
+        if (open_video_sink(videoSink, options.outputPath, options.outputFormat, width, height,
+                            fixedTimestep ? options.fps : 60.0)) {
+            exit(-1);
+        }
+        consumer = write_video_frame;
+        consumerData = &videoSink;
+
+        //Convert to 4:2:0 on the GPU and read back only the planes when the size allows it
+        if (options.outputFormat == VIDEO_Y4M && width % 2 == 0 && height % 2 == 0
+            && !init_yuv_pass(yuvPass, width, height)) {
+            videoSink.planar = true;
+            captureLayout = CAPTURE_YUV420;
+        }
+    }
+    else if (!options.dumpPrefix.empty()) {
+        ppmDump.prefix = options.dumpPrefix;
+        consumer = write_ppm_frame;
+        consumerData = &ppmDump;
+    }
+    else if (!options.comparePrefix.empty()) {
+        frameComparison.prefix = options.comparePrefix;
+        frameComparison.tolerance = options.tolerance;
+        consumer = compare_frame;
+        consumerData = &frameComparison;
+    }
 
-        if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
-            glfwSetWindowShouldClose(window, true);
+    CaptureRing capture;
+    if (capturing) {
+        if (init_capture(capture, options.captureSlots, width, height, captureLayout, consumer, consumerData)) {
+            exit(-1);
         }
+    }
 
-        glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    //Each frame becomes one more sample of a float32 running mean
+    Accumulator accumulator;
+    if (options.accumulate && init_accumulator(accumulator, width, height)) {
+        exit(-1);
+    }
 
+    //Trade image pass resolution for frame rate
+    DynamicResolution dynamicResolution;
+    if (options.dynamicResolution > 0.0
+        && init_dynamic_resolution(dynamicResolution, width, height, options.dynamicResolution,
+                                   options.minScale, options.sharpen)) {
+        exit(-1);
+    }
+
+    Interleave interleave;
+    if (options.interleave && init_interleave(interleave, options.interleave, width, height)) {
+        exit(-1);
+    }
+
+    Supersample supersample;
+    if (options.supersample > 1
+        && init_supersample(supersample, options.supersample, options.downsampleFilter,
+                            options.supersampleJitter, width, height)) {
+        exit(-1);
+    }
+
+    //Full resolution only around the focus point
+    Foveation foveation;
+    if (options.foveate > 0.0f
+        && init_foveation(foveation, options.foveate, options.focusMouse, options.focusX, options.focusY, width, height)) {
+        exit(-1);
+    }
 
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
+    //Live editing: new programs compile in the background and are swapped in once linked
+    ShaderReloader reloader;
+    if (options.watch) {
+        std::vector<std::string> paths(1, options.shaderPath);
+        for (int channel = 0; channel < CHANNEL_COUNT; channel++) {
+            paths.push_back(options.bufferPaths[channel]);
+        }
+
+        if (init_shader_reloader(reloader, paths, compiler)) {
+            exit(-1);
+        }
+        reloader.shaders[0]->prelude = options.quality > 0.0 ? quality_prelude(quality, quality.level) : imagePrelude;
+    }
 
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    //Enough queries in flight that reading results never waits on the GPU
+    Benchmark benchmark;
+    if (options.benchmark && init_benchmark(benchmark, 4)) {
+        exit(-1);
+    }
+
+    //An untimed draw of the image pass first, as tune does. It absorbs the shader JIT, and
+    //llvmpipe reports its absolute clock for a timer query that precedes every draw
+    if (options.benchmark) {
+        glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+        glViewport(0, 0, frameState.width, frameState.height);
         glUseProgram(shaderProgram);
-        glUniform1f(glGetUniformLocation(shaderProgram, "iTime"), currentFrame);
+        push_frame_uniforms(uniforms, frameState);
         glBindVertexArray(VAO);
         glDrawArrays(GL_TRIANGLES, 0, 6);
+        glFinish();
+    }
 
+    unsigned long frameCount = 0;
+    double loopStart = get_time();
 
-        glfwSwapBuffers(window);
-        glfwPollEvents();
+    //Headless: the previous frame's fence, waited on to bound the frames queued ahead of the GPU
+    GLsync frameFence = nullptr;
 
-    }
+    while (!quitRequested && (options.headless || !glfwWindowShouldClose(window))
+           && (options.frames == 0 || frameCount < options.frames)) {
 
-    //Cleanup
-    Pa_StopStream(audioStream);
-    Pa_CloseStream(audioStream);
-    Pa_Terminate();
-    glfwTerminate();
-}
+        float currentFrame = fixedTimestep ? options.startTime + frameCount / options.fps
+                                           : options.startTime + get_time();
+        deltaTime = fixedTimestep ? static_cast<float>(1.0 / options.fps) : currentFrame - lastFrame;
+        lastFrame = currentFrame;
 
-void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
-    //Make sure the viewport matches the new window dimensions; note that width and
-    //height will be significantly larger than specified on retina displays.
-    glViewport(0, 0, width, height);
+        double frameStart = get_time();
 
-    //Update the iResolution uniform in the shader
-    glUniform2fv(glGetUniformLocation(shaderProgram, "iResolution"), 1, &glm::vec2(width, height)[0]);
-}
+        if (window && glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
+            glfwSetWindowShouldClose(window, true);
+        }
+
+        if (options.watch) {
+            GLuint reloaded;
+            std::string reloadedSource;
+            int index;
+            while ((index = poll_shader_reloader(reloader, reloaded, reloadedSource)) >= 0) {
+                if (index == 0) {
+                    //The controller owns the program in use and starts over from the compiled source
+                    if (options.quality > 0.0) {
+                        reload_quality_controller(quality, reloadedSource, reloaded);
+                        reloader.shaders[0]->prelude = quality_prelude(quality, quality.level);
+                    }
+                    else {
+                        glDeleteProgram(shaderProgram);
+                    }
+                    shaderProgram = reloaded;
+                    reflect_uniforms(shaderProgram, uniforms);
+                    glUseProgram(shaderProgram);
+                    bind_channel_units(uniforms);
+                }
+                else {
+                    replace_buffer_program(passChain, index - 1, reloaded);
+                }
+
+                //The old samples belong to the old shader
+                accumulator.samples = 0;
+            }
+        }
+
+        //Switch to a cheaper or better variant when the measured frame time calls for it
+        if (options.quality > 0.0 && update_quality(quality, shaderProgram)) {
+            reflect_uniforms(shaderProgram, uniforms);
+            glUseProgram(shaderProgram);
+            bind_channel_units(uniforms);
+            accumulator.samples = 0;
+        }
+
+        //Position of the sample being heard right now, so visuals stay locked to the music
+        if (playingFile && options.audioChannel >= 0) {
+            frameState.channelTime[options.audioChannel] = audio_player_time(audioPlayer, audio_backend_time(audioBackend));
+        }
+
+        frameState.time = currentFrame;
+        frameState.timeDelta = deltaTime;
+        frameState.frame = frameCount;
+
+        //Keep the GPU a few seconds ahead of the speakers
+        if (playingSound) {
+            update_sound_shader(soundShader, VAO);
+        }
+
+        //Everything the frame puts on the GPU, from the audio texture to the readback. The sound
+        //shader above renders seconds of audio at a time and isn't part of the frame
+        if (options.benchmark) {
+            begin_gpu_timer(benchmark);
+        }
+
+        //Only upload when the analysis thread has published a newer block
+        const float* audioBlock;
+        if (audioTexture.texture && latest_audio_block(audioAnalysis, audioBlock)) {
+            update_audio_texture(audioTexture, audioBlock);
+        }
 
-int read_file(const char* filePath, std::string& fileString) {
-    std::string fragmentCode;
-    std::ifstream fShaderFile;
+        if (multipass) {
+            //A resized window restarts the buffers at the new size
+            if (passChain.width != frameState.width || passChain.height != frameState.height) {
+                resize_pass_chain(passChain, frameState.width, frameState.height);
+            }
+            render_buffer_passes(passChain, frameState, VAO);
+        }
+        bind_channel_textures(passChain);
+
+        //The image pass sees the render size when it is scaled. Foveation zones bind their own
+        //targets and push their own uniforms in render_foveation_zones
+        FrameState imageState = frameState;
+        glUseProgram(shaderProgram);
+        bool dynamicFrame = false;
+        bool supersampleFrame = false;
+        if (dynamicResolution.program) {
+            dynamicFrame = begin_dynamic_resolution(dynamicResolution, frameState, imageState);
+        }
+        else if (interleave.program) {
+            begin_interleave(interleave, shaderProgram, frameState.width, frameState.height);
+        }
+        else if (supersample.program) {
+            supersampleFrame = begin_supersample(supersample, shaderProgram, frameState, imageState);
+        }
+
+        //Without their target (a resize they couldn't follow) dynamic resolution and supersampling
+        //render straight to the output
+        bool ownTarget = dynamicFrame || interleave.program || supersampleFrame || foveation.program;
+        if (!ownTarget && options.accumulate) {
+            begin_accumulation(accumulator, frameState);
+        }
+        else if (!ownTarget) {
+            glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+            glViewport(0, 0, frameState.width, frameState.height);
+        }
+        if (!foveation.program) {
+            push_frame_uniforms(uniforms, imageState);
+        }
+        glBindVertexArray(VAO);
 
-    fShaderFile.exceptions (std::ifstream::failbit | std::ifstream::badbit);
+        if (options.quality > 0.0) {
+            begin_quality_timer(quality);
+        }
+        if (foveation.program) {
+            render_foveation_zones(foveation, uniforms, frameState, VAO);
+        }
+        else {
+            glDrawArrays(GL_TRIANGLES, 0, 6);
+        }
+        if (options.quality > 0.0) {
+            end_quality_timer(quality);
+        }
 
-    try {
-      //First attempt to read the file
-      fShaderFile.open(filePath);
-      std::stringstream fShaderStream;
+        if (dynamicFrame) {
+            end_dynamic_resolution(dynamicResolution, targetFramebuffer, VAO);
+        }
+        else if (interleave.program) {
+            end_interleave(interleave, targetFramebuffer, VAO);
+        }
+        else if (foveation.program) {
+            composite_foveation(foveation, targetFramebuffer, VAO);
+        }
+        else if (supersampleFrame) {
+            //The filtered frame is what gets accumulated
+            if (options.accumulate) {
+                begin_accumulation(accumulator, frameState);
+            }
+            else {
+                glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+                glViewport(0, 0, frameState.width, frameState.height);
+            }
+            resolve_supersample(supersample, VAO);
+        }
 
-      //Read file's buffer contents into streams
-      fShaderStream << fShaderFile.rdbuf();
+        if (options.accumulate) {
+            end_accumulation(accumulator, targetFramebuffer);
+        }
 
-      //Close
-      fShaderFile.close();
+        if (capturing) {
+            if (videoSink.planar) {
+                render_yuv_pass(yuvPass, texColor, VAO);
+                capture_frame(capture, yuvPass.framebuffer);
+            }
+            else {
+                capture_frame(capture, targetFramebuffer);
+            }
+
+            //The encoder went away, there is nothing left to render for
+            if (videoSink.failed)
+                quitRequested = 1;
+
+            //Show the captured frame in the window
+            if (window) {
+                glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+                glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+                glBlitFramebuffer(0, 0, width, height, 0, 0, width, height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+            }
 
-      //Stream into string
-      fileString = fShaderStream.str();
+        }
+
+        if (options.benchmark) {
+            end_gpu_timer(benchmark);
+        }
+
+        frameCount++;
+
+        if (window) {
+            glfwSwapBuffers(window);
+            glfwPollEvents();
+        }
+        else {
+            //Submit the frame, then wait until the previous one has finished so at most two frames
+            //are queued, as swapping buffers would limit a window
+            GLsync fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+            glFlush();
+            if (frameFence) {
+                glClientWaitSync(frameFence, 0, GL_TIMEOUT_IGNORED);
+                glDeleteSync(frameFence);
+            }
+            frameFence = fence;
+        }
+
+        if (options.benchmark) {
+            record_cpu_time(benchmark, (get_time() - frameStart) * 1000.0);
+        }
 
     }
-    catch (std::ifstream::failure& e) {
-      std::cout << "ERROR::SHADER::FILE_NOT_SUCCESSFULLY_READ: " << e.what() << std::endl;
-      return -1;
+
+    //Cleanup
+    int status = 0;
+    if (capturing) {
+        flush_capture(capture);
+        destroy_capture(capture);
+        destroy_yuv_pass(yuvPass);
+
+        //Frames that differ from the reference fail the run, apart from setup errors
+        if (!options.comparePrefix.empty() && summarize_comparison(frameComparison))
+            status = 1;
+    }
+    destroy_shader_reloader(reloader);
+    destroy_quality_controller(quality);
+    destroy_pass_chain(passChain);
+    destroy_audio_texture(audioTexture);
+    destroy_accumulator(accumulator);
+    destroy_dynamic_resolution(dynamicResolution);
+    destroy_interleave(interleave);
+    destroy_supersample(supersample);
+    destroy_foveation(foveation);
+    close_video_sink(videoSink);
+
+    //The callback stops first, it reads from the sound shader
+    stop_audio();
+    destroy_sound_shader(soundShader);
+
+    if (options.benchmark) {
+        finish_benchmark(benchmark);
+        write_benchmark_json(benchmark, std::cout);
     }
 
-    return 0;
-}
+    if (options.headless) {
+        glFinish();
+        if (frameFence)
+            glDeleteSync(frameFence);
+        destroy_shared_headless_context(compileContext);
+        double elapsed = get_time() - loopStart;
+        std::cerr << "Rendered " << frameCount << " frames in " << elapsed << "s ("
+                  << (elapsed > 0.0 ? frameCount / elapsed : 0.0) << " fps)" << std::endl;
 
-//Check the compile errors
-void checkCompileErrors(unsigned int shader, std::string type) {
-    int success;
-    char infoLog[1024];
-    if (type != "PROGRAM") {
-        glGetShaderiv(shader, GL_COMPILE_STATUS, &success);
-        if (!success) {
-            glGetShaderInfoLog(shader, 1024, NULL, infoLog);
-            std::cout << "ERROR::SHADER_COMPILATION_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
-        }
+        destroy_headless_context(headless);
     }
     else {
-        glGetProgramiv(shader, GL_LINK_STATUS, &success);
-        if (!success) {
-            glGetProgramInfoLog(shader, 1024, NULL, infoLog);
-            std::cout << "ERROR::PROGRAM_LINKING_ERROR of type: " << type << "\n" << infoLog << "\n -- --------------------------------------------------- -- " << std::endl;
+        if (compileWindow) {
+            glfwDestroyWindow(compileWindow);
         }
+        glfwTerminate();
     }
+
+    return status;
+}
+
+void framebuffer_size_callback(GLFWwindow* window, int width, int height) {
+    //Make sure the viewport matches the new window dimensions; note that width and
+    //height will be significantly larger than specified on retina displays.
+    glViewport(0, 0, width, height);
+
+    //Update the iResolution of the next frame
+    frameState.width = width;
+    frameState.height = height;
 }
 
 void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
   float x = static_cast<float>(xpos);
   float y = static_cast<float>(ypos);
 
-  //Set the iMouse uniform variable to actual screen x and y
-  glUniform2f(glGetUniformLocation(shaderProgram, "iMouse"), x, y);
+  //Set the iMouse of the next frame to actual screen x and y
+  frameState.mouseX = x;
+  frameState.mouseY = y;
 }
@@ -5,7 +5,10 @@ uniform float iTime;
 
 #define PI 3.14159265359
 
-const int MAX_MARCHING_STEPS = 255;
+// @quality MAX_MARCHING_STEPS 32..255
+#ifndef MAX_MARCHING_STEPS
+#define MAX_MARCHING_STEPS 255
+#endif
 const float MIN_DIST = 0.0;
 const float MAX_DIST = 100.0;
 const float PRECISION = 0.001;
@@ -13,15 +13,24 @@ vec2 fragCoord = gl_FragCoord.xy;
  * Contact: tdmaav@gmail.com
  */
 
-const int NUM_STEPS = 8;
+// @quality NUM_STEPS 4..16
+#ifndef NUM_STEPS
+#define NUM_STEPS 8
+#endif
 const float PI	 	= 3.141592;
 const float EPSILON	= 1e-3;
 #define EPSILON_NRM (0.1 / iResolution.x)
 //#define AA
 
 // sea
-const int ITER_GEOMETRY = 3;
-const int ITER_FRAGMENT = 5;
+// @quality ITER_GEOMETRY 2..4
+// @quality ITER_FRAGMENT 3..5
+#ifndef ITER_GEOMETRY
+#define ITER_GEOMETRY 3
+#endif
+#ifndef ITER_FRAGMENT
+#define ITER_FRAGMENT 5
+#endif
 const float SEA_HEIGHT = 0.6;
 const float SEA_CHOPPY = 4.0;
 const float SEA_SPEED = 0.8;
@@ -0,0 +1,76 @@
+#!/bin/sh
+#Golden image regression suite: renders the bundled shaders headless on Mesa llvmpipe at fixed
+#iTime values, compares every frame with tests/golden/<shader>_<frame>.ppm and fails if one differs
+#by more than the tolerance. GPU/CPU time of every frame goes to golden-results/<shader>.json and
+#one line per shader is appended to golden-results/timings.tsv, to spot performance regressions.
+#
+#  tests/golden.sh           Check against the golden frames
+#  tests/golden.sh --update  Render new golden frames (after an intended change to the picture)
+#
+#SHADED is the binary (default ./shaded), GOLDEN_TOLERANCE the largest mean perceptual difference
+#(FLIP-style, 0-1) a frame may have (default 0.005, darkening a shader by 1-2% gives about 0.008-0.01)
+
+SHADED=${SHADED:-./shaded}
+TOLERANCE=${GOLDEN_TOLERANCE:-0.005}
+GOLDEN=tests/golden
+RESULTS=golden-results
+SHADERS="ocean neon cat_bounce"
+
+#iTime 0.5, 4.5 and 8.5 at 160x90, small enough to keep the golden frames in the repository
+RENDER="--headless --no-cache --size 160x90 --start 0.5 --fps 0.25 --frames 3"
+
+#The golden frames are llvmpipe's, other drivers round differently
+LIBGL_ALWAYS_SOFTWARE=1
+GALLIUM_DRIVER=llvmpipe
+export LIBGL_ALWAYS_SOFTWARE GALLIUM_DRIVER
+
+cd "$(dirname "$0")/.." || exit 1
+
+if [ ! -x "$SHADED" ]; then
+    echo "$SHADED not found, build it with make first" >&2
+    exit 1
+fi
+
+if [ "$1" = "--update" ]; then
+    mkdir -p "$GOLDEN"
+    for shader in $SHADERS; do
+        "$SHADED" $RENDER --dump-frames "$GOLDEN/$shader" "shaders/$shader.glsl" || exit 1
+    done
+    exit 0
+fi
+
+mkdir -p "$RESULTS"
+if [ ! -f "$RESULTS/timings.tsv" ]; then
+    printf 'time\tcommit\tshader\tgpu_median_ms\tcpu_median_ms\n' > "$RESULTS/timings.tsv"
+fi
+
+failed=""
+for shader in $SHADERS; do
+    "$SHADED" $RENDER --benchmark --compare "$GOLDEN/$shader" --tolerance "$TOLERANCE" \
+        "shaders/$shader.glsl" > "$RESULTS/$shader.json" 2> "$RESULTS/$shader.log"
+    status=$?
+
+    if ! grep -q llvmpipe "$RESULTS/$shader.log"; then
+        echo "$shader: not rendered on llvmpipe, see $RESULTS/$shader.log" >&2
+        exit 1
+    fi
+
+    #Medians of the "gpu" and "cpu" objects, in that order
+    medians=$(grep '"median"' "$RESULTS/$shader.json" | sed 's/.*: *//; s/,$//' | tr '\n' ' ')
+    set -- $medians
+    printf '%s\t%s\t%s\t%s\t%s\n' "$(date -u +%Y-%m-%dT%H:%M:%SZ)" \
+        "$(git rev-parse --short HEAD 2>/dev/null)" "$shader" "$1" "$2" >> "$RESULTS/timings.tsv"
+
+    if [ $status -eq 0 ]; then
+        echo "PASS $shader (median GPU $1 ms, CPU $2 ms)"
+    else
+        echo "FAIL $shader"
+        grep "Frame\|Compared\|rror" "$RESULTS/$shader.log" | sed 's/^/    /'
+        failed="$failed $shader"
+    fi
+done
+
+if [ -n "$failed" ]; then
+    echo "Golden image mismatch:$failed" >&2
+    exit 1
+fi